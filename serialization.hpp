@@ -8,16 +8,20 @@
  */
 
 #include <algorithm>
-#include <any>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <limits>
 #include <list>
 #include <map>
 #include <memory>
+#include <memory_resource>
 #include <numeric>
 #include <set>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 #include <unordered_map>
@@ -25,6 +29,24 @@
 
 #include <nvx/type.hpp>
 
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define NVX_BYTESWAP_SIMD
+#endif
+
+#ifdef NVX_SERIALIZATION_STATS
+#include <chrono>
+#endif
+
+// Архив со статистикой получает другое имя при компоновке:
+// функции, принимающие archive и собранные с макросом и без
+// него, не будут молча смешаны, а дадут ошибку компоновки
+#if defined(NVX_SERIALIZATION_STATS) && (defined(__GNUC__) || defined(__clang__))
+#define NVX_SERIALIZATION_ABI __attribute__((abi_tag("nvx_stats")))
+#else
+#define NVX_SERIALIZATION_ABI
+#endif
+
 
 
 
@@ -145,210 +167,322 @@ inline void open_io_file(std::fstream *stream, std::string const &filename)
 
 
 
-/* ARCHIVE */
-typedef int32_t id_t;
-constexpr id_t NULL_ID = std::numeric_limits<id_t>::min();
+/* STREAMS */
+/*!
+ * \defgroup streams Потоки архива
+ *
+ * Собственные потоки, которые можно использовать в качестве
+ * параметра Stream класса archive вместо потоков стандартной
+ * библиотеки; их методы write и operator bool не виртуальные
+ * и встраиваются в функции сериализации, так что запись
+ * фундаментального значения сводится к копированию байт
+ *
+ * @{
+ */
 
-/// Перечисление, которое отвечает за режим работы архива;
-/// режими можно комбинировать с помощью оператора |
-enum ArchiveMode
+/********************* OUTPUT BUFFERS *********************/
+/// Растущий буфер в оперативной памяти
+/*!
+ * Поток вывода, который дописывает байты в конец строки;
+ * строка может принадлежать самому потоку или быть передана
+ * извне (тогда данные дописываются к её текущему содержимому)
+ */
+class buffer_ostream
 {
-	/// Ничего не сохранять, не проверять
-	/*!
-	 * Никакие указатели не сохраняются и не проверяются
-	 */
-	none_mode = 0,
+public:
+	/// Буфер с собственной строкой
+	buffer_ostream():
+		buf(&own) {}
 
-	/// Режим поддержки разделяемых обычных указателей
-	/*!
-	 * Обычные указатели сохраняются и ассоциируются с
-	 * уникальными идентификаторами. Если в дальнейшем потребуется
-	 * десериализовать указатель, который уже встречался,
-	 * то возвратится сохранённый указатель
-	 */
-	determine_pointers_mode = 1 << 0,
+	/// Буфер, дописывающий данные в строку target
+	explicit buffer_ostream(std::string *target):
+		buf(target), start(target->size()) {}
 
-	/// Режим поддержки разделяемых (std::shared_ptr) указателей
-	/*!
-	 * Указатели std::shared_ptr сохраняются и ассоциируются с
-	 * уникальными идентификаторами. Если в дальнейшем потребуется
-	 * десериализовать указатель, который уже встречался,
-	 * то возвратится сохранённый указатель. (Режим по умолчанию)
-	 */
-	determine_shared_mode   = 1 << 1
-};
+	buffer_ostream(buffer_ostream const &) = delete;
+	buffer_ostream &operator=(buffer_ostream const &) = delete;
 
 
 
-template<typename T>
-class Lira;
+	inline void write(char const *data, size_t n)
+	{
+		buf->append(data, n);
+		return;
+	}
 
-/// Класс архива, необходимый для (де)сериализации
+	inline void flush() {}
+
+	/// Буфер в памяти всегда работоспособен
+	inline operator bool() const
+	{
+		return true;
+	}
+
+	/// Число байт, записанных через этот поток
+	inline size_t tellp() const
+	{
+		return buf->size() - start;
+	}
+
+	/// Позиция следующего байта от начала строки, включая
+	/// данные, записанные в неё до создания потока (по ней
+	/// выравнивает aligned_mode)
+	inline size_t offset() const
+	{
+		return buf->size();
+	}
+
+
+
+	/// Резервирование места под ещё n байт
+	inline void reserve(size_t n)
+	{
+		buf->reserve(buf->size() + n);
+		return;
+	}
+
+	/// Удаление записанных через поток данных (ёмкость сохраняется)
+	inline void clear()
+	{
+		buf->resize(start);
+		return;
+	}
+
+	inline char const *data() const
+	{
+		return buf->data() + start;
+	}
+
+	inline size_t size() const
+	{
+		return tellp();
+	}
+
+	/// Строка, в которую производится запись
+	inline std::string &str()
+	{
+		return *buf;
+	}
+
+	inline std::string const &str() const
+	{
+		return *buf;
+	}
+
+private:
+	std::string  own;
+	std::string *buf;
+	size_t start = 0;
+};
+
+
+
+/// Промежуточный буфер фиксированного размера
 /*!
- * Указатели сохраняются только в пределах класса archive.
- *
- * \param Stream — класс потока, использующийся для
- * (де)сериализации, например, ostream или istream,
- * также stringstream; класс должен иметь следующие методы:
- * - operator bool()
- * - write( char const *, size_t )
- * - read( char *, size_t )
- * - tellp, seekp, tellg, seekg
- *
- * \param Meta — в случае если используется Lira,
- * соответствует типу её метаобъектов; иначе не
- * имеет смысла
- *
+ * Накапливает записываемые байты и передаёт их потоку Stream
+ * крупными блоками; данные, не помещающиеся в буфер целиком,
+ * передаются потоку напрямую. Оставшиеся в буфере данные
+ * сбрасываются методом flush() и в деструкторе
  *
+ * \param Stream — поток с методами write, flush,
+ * operator bool и (если используется tellp) tellp
  */
-template<class Stream, typename Meta = void>
-class archive
+template<class Stream>
+class staging_ostream
 {
 public:
+	explicit staging_ostream(Stream *s, size_t capacity = 1 << 16):
+		s(s), buf(new char[capacity]), cap(capacity) {}
 
-	/// Конструктор по умолчанию
-	archive(Stream *s, int mode = determine_shared_mode):
-		s(s), mode(mode) {}
-
-
+	staging_ostream(staging_ostream const &) = delete;
+	staging_ostream &operator=(staging_ostream const &) = delete;
 
-	/// Получения потока
-	Stream *stream() const
+	~staging_ostream()
 	{
-		return s;
+		drain();
+		return;
 	}
 
 
 
-	/// Сериализация с опомщью оператора <<
-	template<typename T>
-	archive &operator<<(T t)
+	inline void write(char const *data, size_t n)
 	{
-		if(!s)
-			return *this;
-		serialize(*this, t);
-		return *this;
+		if(n > cap - len)
+		{
+			drain();
+			if(n >= cap)
+			{
+				s->write(data, n);
+				return;
+			}
+		}
+
+		std::copy(data, data + n, buf.get() + len);
+		len += n;
+		return;
 	}
 
-	/// Десериализация с помощью оператора >>
-	template<typename T>
-	archive &operator>>(T t)
+	/// Передача накопленных данных потоку и его сброс
+	void flush()
 	{
-		if(!s)
-			return *this;
-		deserialize(*this, t);
-		return *this;
+		drain();
+		s->flush();
+		return;
 	}
 
-	/// Проверка потока на работоспособность
-	operator bool() const
+	inline operator bool() const
 	{
-		return s && (bool)*s;
+		return (bool)*s;
+	}
+
+	inline auto tellp()
+	{
+		return s->tellp() + (std::streamoff)len;
 	}
 
+	/// Позиция от начала буфера Stream (если он её сообщает)
+	template<class S = Stream>
+	inline auto offset() -> decltype(std::declval<S &>().offset())
+	{
+		return s->offset() + len;
+	}
 
+	Stream *stream() const
+	{
+		return s;
+	}
 
 private:
-	friend class nvx::Lira<Meta>;
+	void drain()
+	{
+		if(len)
+			s->write(buf.get(), len);
+		len = 0;
+		return;
+	}
 
 	Stream *s;
-	int  mode;
+	std::unique_ptr<char[]> buf;
+	size_t cap;
+	size_t len = 0;
+};
 
-	// Сопоставление каждому идентификатору объекту в ОП
-	std::unordered_map<id_t, std::pair<void *, std::any>> idns;
 
-	// Сопоставление каждому объекту в ОП идентификатора
-	// и числу указывающих на него объектов
-	std::unordered_map<void *, std::pair<id_t, int>> objs;
 
-	Lira<Meta> *lira = nullptr;
+/// Поток, который только считает записываемые байты
+/*!
+ * Используется для вычисления размера сериализованного
+ * объекта (см. serialized_size), ничего никуда не записывая
+ */
+class size_ostream
+{
+public:
+	inline void write(char const *data, size_t n)
+	{
+		count += n;
+		return;
+	}
 
-	int freshness = 0;
-	int curid     = 0;
-	int incid     = 0;
+	inline void flush() {}
 
-	id_t newid()
+	inline operator bool() const
 	{
-		if(lira)
-			return lira->next_shared_id();
-		return incid++;
+		return true;
 	}
 
+	inline size_t tellp() const
+	{
+		return count;
+	}
 
+private:
+	size_t count = 0;
+};
 
-	// pointers
-	template<class Ostream, typename M, typename T>
-	friend int _serialize_dispatcher(
-		archive<Ostream, M> &os,
-		T const *obj,
-		std::true_type,
-		bool write
-	);
 
-	template<class Ostream, typename M, typename T>
-	friend int _deserialize_dispatcher(
-		archive<Ostream, M> &os,
-		T *obj,
-		std::true_type
-	);
 
+/********************* INPUT BUFFERS **********************/
+/// Поток чтения из области памяти
+/*!
+ * Читает данные непосредственно из памяти, принадлежащей
+ * вызывающей стороне (память не копируется и должна оставаться
+ * доступной, пока используется поток). Попытка прочитать больше,
+ * чем осталось, ничего не читает и переводит поток в нерабочее
+ * состояние, как и у стандартных потоков
+ */
+class memory_istream
+{
+public:
+	memory_istream(char const *data, size_t size):
+		beg(data), cur(data), end(data + size) {}
 
-	// shared prointers
-	template<class Ostream, typename M, typename T>
-	friend int serialize(
-		archive<Ostream, M> &os,
-		std::shared_ptr<T> const *obj,
-		bool write
-	);
+	explicit memory_istream(std::string const &src):
+		memory_istream(src.data(), src.size()) {}
 
-	template<class Ostream, typename M, typename T>
-	friend int serialize(
-		archive<Ostream, M> &os,
-		std::shared_ptr<T> const *obj,
-		bool write
-	);
 
-	template<class Istream, typename M, typename T>
-	friend int deserialize(
-		archive<Istream, M> &is,
-		std::shared_ptr<T> *obj
-	);
 
+	inline void read(char *data, size_t n)
+	{
+		if(char const *p = take(n))
+			std::copy(p, p + n, data);
+		return;
+	}
 
-	// final
-	template<class Ostream, typename M, typename T>
-	friend int _serialize_final(
-		archive<Ostream, M> &os,
-		T const *value,
-		std::true_type isfundamental,
-		bool write
-	);
+	/// Получение указателя на следующие n байт с продвижением
+	/// позиции; при нехватке данных возвращает nullptr
+	inline char const *take(size_t n)
+	{
+		if(n > (size_t)(end - cur))
+		{
+			fail = true;
+			return nullptr;
+		}
 
-	template<class Istream, typename M, typename T>
-	friend int _deserialize_final(
-		archive<Istream, M> &is,
-		T *value,
-		std::true_type isfundamental
-	);
+		char const *p = cur;
+		cur += n;
+		return p;
+	}
 
+	inline operator bool() const
+	{
+		return !fail;
+	}
 
-	// plain
-	template<class Ostream, typename M>
-	friend int serialize_plain(
-		archive<Ostream, M> &os,
-		void const *obj,
-		int size,
-		bool write
-	);
+	inline size_t tellg() const
+	{
+		return cur - beg;
+	}
 
-	template<class Istream, typename M>
-	friend int deserialize_plain(
-		archive<Istream, M> &is,
-		void *obj,
-		int size
-	);
+	inline void seekg(size_t pos)
+	{
+		if(pos > (size_t)(end - beg))
+		{
+			fail = true;
+			return;
+		}
+		cur = beg + pos;
+		return;
+	}
+
+	/// Число ещё не прочитанных байт
+	inline size_t remaining() const
+	{
+		return end - cur;
+	}
+
+	inline void clear()
+	{
+		fail = false;
+		return;
+	}
+
+private:
+	char const *beg;
+	char const *cur;
+	char const *end;
+	bool fail = false;
 };
 
+/*! @} */
 
 
 
@@ -358,1917 +492,5159 @@ private:
 
 
 
-/* MACROS */
-/********************** HELP FOR MACROS *********************/
-/*
- * Следующие структуры и функции обспечивают работу
- * макросов, которые включаются внутрь сериализуемых
- * классов и структур
+
+/* TRAITS */
+/*!
+ * \defgroup traits Свойства типов
+ *
+ * Свойства типов, по которым на этапе компиляции выбирается
+ * способ (де)сериализации
+ *
+ * @{
  */
 
+/// Является ли тип плоской структурой (NVX_SERIALIZABLE_PLAIN)
 /*!
- * Структура, представляющая сериализуемый динамический
- * массив; необходимо обратить внимание на то, что размер
- * всегда должен быть указателем на тип int
+ * Макрос должен быть указан в самом типе: наследник плоской
+ * структуры со своими полями плоским не считается
  */
+template<typename T, typename = void>
+struct is_plain_serializable: std::false_type {};
+
 template<typename T>
-struct _serializable_dynamic_array_type
-{
-	T ptr;
-	int *size;
-};
+struct is_plain_serializable<T, std::void_t<decltype(std::declval<T const &>()._nvx_plain_self())>>:
+	std::is_same<decltype(std::declval<T const &>()._nvx_plain_self()), T> {};
+
+
+
+/// Объявлены ли в классе собственные after_serialization
+/// или after_deserialization
+template<typename T, typename = void>
+struct _has_serialization_hooks: std::false_type {};
 
-/*!
- * Структура, представляющая статический массив; при
- * сериализации статического массива в начало данных
- * не передаётся их размер
- */
 template<typename T>
-struct _serializable_static_array_type
-{
-	T ptr;
-	int const SIZE;
-};
+struct _has_serialization_hooks<T, std::void_t<decltype(&T::after_serialization)>>:
+	std::true_type {};
 
+template<typename T, typename = void>
+struct _has_deserialization_hooks: std::false_type {};
 
+template<typename T>
+struct _has_deserialization_hooks<T, std::void_t<decltype(&T::after_deserialization)>>:
+	std::true_type {};
 
-// serialize cascade
+
+
+/// Можно ли (де)сериализовать массив элементов типа T
+/// одним копированием памяти
 /*!
- * Сериазизация нескольких элементов разного типа
- * (в том числе динамических и статических массивов, но
- * дле этого их нужно обернуть в соответствующие структуры
- * или использовать для этого соответствующие макросы)
+ * Это фундаментальные типы и плоские структуры без
+ * собственных after_serialization и after_deserialization:
+ * их сериализованное представление совпадает с
+ * представлением в оперативной памяти
  */
-template<class Ostream>
-inline int serialize_elements(
-	archive<Ostream> &os,
-	bool write = true
-)
-{
-	return 0;
-}
+template<typename T>
+struct is_bulk_serializable: std::integral_constant<bool,
+	std::is_arithmetic<T>::value || (
+		is_plain_serializable<T>::value &&
+		!_has_serialization_hooks<T>::value &&
+		!_has_deserialization_hooks<T>::value
+	)
+> {};
 
-template<class Ostream, typename T, typename...Args>
-inline int serialize_elements(
-	archive<Ostream> &os, bool write,
-	_serializable_dynamic_array_type<T> arr,
-	Args...args
-)
-{
-	return serialize_array(os, arr.ptr, arr.size, write) +
-		   serialize_elements(os, write, args...);
-}
 
-template<class Ostream, typename T, typename...Args>
-inline int serialize_elements(
-	archive<Ostream> &os, bool write,
-	_serializable_static_array_type<T> arr,
-	Args...args
-)
-{
-	return serialize_static(os, arr.ptr, arr.SIZE, write) +
-		   serialize_elements(os, write, args...);
-}
 
-template<class Ostream, typename Head, typename...Args>
-inline int serialize_elements(
-	archive<Ostream> &os,
-	bool write,
-	Head head,
-	Args...args
-)
-{
-	return serialize(os, head, write) +
-		serialize_elements(os, write, args...);
-}
+/// Записывается ли тип в формате varint в режиме varint_mode
+/// (целые числа размером больше одного байта)
+template<typename T>
+struct _is_varint: std::integral_constant<bool,
+	std::is_integral<std::remove_cv_t<T>>::value &&
+	!std::is_same<std::remove_cv_t<T>, bool>::value &&
+	(sizeof(T) > 1)
+> {};
 
 
 
-// deserialize cascade
-/*!
- * Десериализация нескольких элементов разного типа
- * (в том числе динамических и статических массивов, но
- * дле этого их нужно обернуть в соответствующие структуры
- * или использовать для этого соответствующие макросы)
- */
-template<class Istream>
-inline int deserialize_elements(archive<Istream> &is)
-{
-	return 0;
-}
+/// Является ли контейнер упорядоченным ассоциативным
+/// контейнером (set, multiset, map, multimap)
+template<typename Container, typename = void>
+struct _is_ordered_container: std::false_type {};
 
-template<class Istream, typename T, typename...Args>
-inline int deserialize_elements(
-	archive<Istream> &is,
-	_serializable_dynamic_array_type<T> arr,
-	Args...args
-)
-{
-	return deserialize_array(is, arr.ptr, arr.size) +
-		   deserialize_elements(is, args...);
-}
+template<typename Container>
+struct _is_ordered_container<Container, std::void_t<
+	typename Container::key_compare
+>>: std::true_type {};
 
-template<class Istream, typename T, typename...Args>
-inline int deserialize_elements(
-	archive<Istream> &is,
-	_serializable_static_array_type<T> arr,
-	Args...args
-)
-{
-	return deserialize_static(is, arr.ptr, arr.SIZE) +
-		   deserialize_elements(is, args...);
-}
 
-template<class Istream, typename Head, typename...Args>
-inline int deserialize_elements(archive<Istream> &is, Head head, Args...args)
-{
-	return deserialize(is, head) + deserialize_elements(is, args...);
-}
 
+/// Является ли контейнер упорядоченным по возрастанию
+/// ассоциативным контейнером с целочисленными ключами
+/// (ключи таких контейнеров можно записывать разностями)
+template<typename Container, typename = void>
+struct _is_delta_container: std::false_type {};
 
+template<typename Container>
+struct _is_delta_container<Container, std::enable_if_t<
+	std::is_same<
+		typename Container::key_compare,
+		std::less<typename Container::key_type>
+	>::value &&
+	_is_varint<typename Container::key_type>::value
+>>: std::true_type {};
 
 
 
-/************************** ARRAYS **************************/
-/*!
- * Макросы для сериализации динамических и статических массив;
- * в макросы передаются два параметра: массив и размер; существуют
- * существенные отличия между динамическими и статическими массивами:
- *
- *   1. В качестве данных в динамеческом массиве выступает указатель
- *      на массив (то есть указатель на указатель на тип данных масива) —
- *      это используется для того, чтобы автоматически выделить необхо-
- *      димое количество памяти; в то время как для статического массива
- *      указывается сам массив без взятия адреса
- *
- *   2. При сериализации динамического массива указывается указатель на
- *      переменную содержащую размер (всегда int *), для того, чтобы
- *      при сериализации узнать число элементов и при десериализации
- *      записать его; в статическом массиве указывается непосредственно
- *      целое число (будет представлено как int)
- */
-#define NVX_SERIALIZABLE_DYNAMIC_ARRAY(ptr, sizeptr) \
-	nvx::_serializable_dynamic_array_type< \
-		typename std::remove_reference<decltype(**ptr)>::type ** \
-	> { \
-		(typename std::remove_reference<decltype(**ptr)>::type **)ptr, \
-		(typename std::remove_const< \
-		 	typename std::remove_reference<decltype(*sizeptr) \
-		>::type>::type *)sizeptr \
-	}
+/// Является ли контейнер хеш-таблицей (unordered-контейнеры)
+template<typename Container, typename = void>
+struct _is_unordered_container: std::false_type {};
 
-#define NVX_SERIALIZABLE_STATIC_ARRAY(ptr, size) \
-	nvx::_serializable_static_array_type< \
-		typename std::remove_reference<decltype(*ptr)>::type * \
-	> { \
-		ptr, size \
-	}
+template<typename Container>
+struct _is_unordered_container<Container, std::void_t<
+	typename Container::hasher,
+	decltype(std::declval<Container &>().bucket_count()),
+	decltype(std::declval<Container &>().rehash(size_t()))
+>>: std::true_type {};
 
 
 
-/************************* IN-STRUCT ************************/
-/*!
- * Эти макросы используется в теле класса или структуры, чтобы
- * сделать его сериализуемым; в качестве аргументов укызавыается:
- *
- *   - Указатели на сериализуемые объекты (фундаментальные типы,
- *     строки, сериализуемые структуры, в том числе стандартные
- *     контейнеры)
- *
- *   - Динамические массивы (используется макрос
- *     NVX_SERIALIZABLE_DYNAMIC_ARRAY(ptr, sizeptr))
- *
- *   - Статические массивы (используется макрос
- *     NVX_SERIALIZABLE_STATIC_ARRAY(ptr, size))
- *
- * Если необходимо совершить действия после сериализации или
- * десериализации, то объявляются методы класса или структуры с
- * именами after_serialization() и after_deserialization()
- * соответственно
- */
+/// Является ли тип std::pair
+template<typename T>
+struct _is_pair: std::false_type {};
 
-#define NVX_SERIALIZABLE(...) \
-public: \
-	template<typename Ostream> \
-	int serialize(nvx::archive<Ostream> &os, bool write = true) const \
-	{ \
-		int res = nvx::serialize_elements( os, write, __VA_ARGS__ ); \
-		after_serialization(); \
-		return res; \
-	} \
- \
-	template<typename Istream> \
-	int deserialize(nvx::archive<Istream> &is) \
-	{ \
-		int res = nvx::deserialize_elements( is, __VA_ARGS__ ); \
-		after_deserialization(); \
-		return res; \
-	}
+template<typename T, typename U>
+struct _is_pair<std::pair<T, U>>: std::true_type {};
+
+
+
+/// Является ли тип строкой (std::basic_string)
+template<typename T>
+struct _is_string: std::false_type {};
+
+template<typename...Other>
+struct _is_string<std::basic_string<Other...>>: std::true_type {};
+
+
+
+/// Хранит ли контейнер элементы в непрерывной области памяти
+/// (vector, кроме vector<bool>, и basic_string)
+template<typename Container, typename = void>
+struct _is_contiguous_container: std::false_type {};
+
+template<typename Container>
+struct _is_contiguous_container<Container, std::enable_if_t<std::is_same<
+	decltype(std::declval<Container &>().data()),
+	typename Container::value_type *
+>::value>>: std::true_type {};
 
+
+
+/// Размер сериализованного представления типа T, если он
+/// не зависит от значения, и -1 иначе
 /*!
- * Используется этот макрос, если структура данных является
- * плоской
+ * Постоянный размер имеют фундаментальные типы, плоские
+ * структуры, статические массивы и пары таких типов, а также
+ * структуры NVX_SERIALIZABLE, все элементы которых имеют
+ * постоянный размер
  */
-#define NVX_SERIALIZABLE_PLAIN() \
-public: \
-	template<class Ostream> \
-	inline int serialize(nvx::archive<Ostream> &os, bool write = true) const \
-	{ \
-		int res = nvx::serialize_plain(os, (void const *)this, sizeof(*this), write); \
-		after_serialization(); \
-		return res; \
-	} \
- \
-	template<class Istream> \
-	inline int deserialize(nvx::archive<Istream> &is) \
-	{ \
-		int res = nvx::deserialize_plain(is, (void *)this, sizeof *this); \
-		after_deserialization(); \
-		return res; \
-	}
+template<typename T, typename = void>
+struct _fixed_size_impl: std::integral_constant<int,
+	std::is_arithmetic<T>::value || is_plain_serializable<T>::value ?
+		(int)sizeof(T) : -1
+> {};
 
+template<typename T>
+struct _fixed_size: _fixed_size_impl<std::remove_cv_t<T>> {};
 
+template<typename T, size_t N>
+struct _fixed_size_impl<T[N]>: std::integral_constant<int,
+	_fixed_size<T>::value < 0 ? -1 : _fixed_size<T>::value * (int)N
+> {};
 
+template<typename T, typename U>
+struct _fixed_size_impl<std::pair<T, U>>: std::integral_constant<int,
+	_fixed_size<T>::value < 0 || _fixed_size<U>::value < 0 ?
+		-1 : _fixed_size<T>::value + _fixed_size<U>::value
+> {};
 
 
-/************************ CONTAINERS ************************/
-// DECLARATIONS
-#define _NVX_SERIALIZE_CONTAINER_DECLARE_CORE(contname, bool_write) \
-	template< \
-		class Ostream, \
-		typename Meta, \
-		typename...Other \
-	> \
-	int serialize( \
-		archive<Ostream, Meta> &os, \
-		contname<Other...> const *cont, \
-		bool_write \
-	)
 
-#define _NVX_DESERIALIZE_RESIZABLE_CONTAINER_DECLARE(contname) \
-	template< \
-		class Istream, \
-		typename Meta, \
-		typename...Other \
-	> \
-	int deserialize( \
-		archive<Istream, Meta> &is, \
-		contname<Other...> *cont  \
-	)
+// Типы элементов, перечисленных в NVX_SERIALIZABLE
+template<typename...Types>
+struct _elements_list {};
 
-#define _NVX_DESERIALIZE_INSERTED_CONTAINER_DECLARE(contname) \
-	template< \
-		class Istream, \
-		typename Meta, \
-		typename...Other \
-	> \
-	int deserialize( \
-		archive<Istream, Meta> &is, \
-		contname<Other...> *cont  \
-	) \
+template<typename...Types>
+inline _elements_list<Types...> _elements_list_of(Types...)
+{
+	return {};
+}
 
+template<typename T>
+struct _element_fixed_size: std::integral_constant<int, -1> {};
 
+template<typename T>
+struct _element_fixed_size<T *>: _fixed_size<T> {};
 
-// DEFINITIONS
-#define _NVX_SERIALIZE_CONTAINER_DEFINE(contname) \
-	_NVX_SERIALIZE_CONTAINER_DECLARE_CORE(contname, bool write) \
-	{ return nvx::serialize_container(os, cont, write); }
+template<typename List>
+struct _elements_fixed_size;
 
-#define _NVX_DESERIALIZE_RESIZABLE_CONTAINER_DEFINE(contname) \
-	_NVX_DESERIALIZE_RESIZABLE_CONTAINER_DECLARE(contname) \
-	{ return nvx::deserialize_resizable_container(is, cont); }
+template<>
+struct _elements_fixed_size<_elements_list<>>:
+	std::integral_constant<int, 0> {};
+
+template<typename Head, typename...Tail>
+struct _elements_fixed_size<_elements_list<Head, Tail...>>: std::integral_constant<int,
+	_element_fixed_size<Head>::value < 0 ||
+	_elements_fixed_size<_elements_list<Tail...>>::value < 0 ? -1 :
+		_element_fixed_size<Head>::value +
+		_elements_fixed_size<_elements_list<Tail...>>::value
+> {};
+
+// Список элементов берётся из обычного метода, чтобы в
+// NVX_SERIALIZABLE можно было обращаться к this
+template<typename T>
+struct _fixed_size_impl<T, std::void_t<decltype(std::declval<T &>()._nvx_elements())>>:
+	_elements_fixed_size<decltype(std::declval<T &>()._nvx_elements())> {};
 
-#define _NVX_DESERIALIZE_INSERTED_CONTAINER_DEFINE(contname) \
-	_NVX_DESERIALIZE_INSERTED_CONTAINER_DECLARE(contname) \
-	{ return nvx::deserialize_inserted_container(is, cont); }
 
 
+/// Имеет ли сериализованное представление типа T
+/// постоянный размер (см. serialized_size<T>())
+template<typename T>
+struct is_fixed_size: std::integral_constant<bool, (_fixed_size<T>::value >= 0)> {};
 
-// SERIALIZATION + DESERIALIZATION
-#define _NVX_SERIALIZABLE_RESIZABLE_CONTANER_DECLARE(contname) \
-	_NVX_SERIALIZE_CONTAINER_DECLARE_CORE(contname, bool write = true); \
-	_NVX_DESERIALIZE_RESIZABLE_CONTAINER_DECLARE(contname);
 
-#define _NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(contname) \
-	_NVX_SERIALIZE_CONTAINER_DECLARE_CORE(contname, bool write = true); \
-	_NVX_DESERIALIZE_INSERTED_CONTAINER_DECLARE(contname);
 
+/// Умеет ли поток отдавать указатель на свои данные
+/// (метод take, см. memory_istream)
+template<typename Stream, typename = void>
+struct _has_take: std::false_type {};
 
-#define _NVX_SERIALIZABLE_RESIZABLE_CONTANER_DEFINE(contname) \
-	_NVX_SERIALIZE_CONTAINER_DEFINE(contname); \
-	_NVX_DESERIALIZE_RESIZABLE_CONTAINER_DEFINE(contname);
+template<typename Stream>
+struct _has_take<Stream, std::void_t<decltype(std::declval<Stream &>().take(size_t()))>>:
+	std::true_type {};
 
-#define _NVX_SERIALIZABLE_INSERTED_CONTANER_DEFINE(contname) \
-	_NVX_SERIALIZE_CONTAINER_DEFINE(contname); \
-	_NVX_DESERIALIZE_INSERTED_CONTAINER_DEFINE(contname);
+/// Сообщает ли поток число оставшихся байт (remaining)
+template<typename Stream, typename = void>
+struct _has_remaining: std::false_type {};
 
+template<typename Stream>
+struct _has_remaining<Stream, std::void_t<decltype(std::declval<Stream &>().remaining())>>:
+	std::true_type {};
 
+/// Умеет ли поток менять позицию записи (seekp)
+template<typename Stream, typename = void>
+struct _has_seekp: std::false_type {};
 
+template<typename Stream>
+struct _has_seekp<Stream, std::void_t<decltype(std::declval<Stream &>().seekp(0))>>:
+	std::true_type {};
 
+/// Умеет ли поток менять позицию чтения (seekg)
+template<typename Stream, typename = void>
+struct _has_seekg: std::false_type {};
 
+template<typename Stream>
+struct _has_seekg<Stream, std::void_t<decltype(std::declval<Stream &>().seekg(0))>>:
+	std::true_type {};
 
+/// Сообщает ли поток позицию записи (tellp)
+template<typename Stream, typename = void>
+struct _has_tellp: std::false_type {};
 
+template<typename Stream>
+struct _has_tellp<Stream, std::void_t<decltype(std::declval<Stream &>().tellp())>>:
+	std::true_type {};
 
+/// Сообщает ли поток позицию чтения (tellg)
+template<typename Stream, typename = void>
+struct _has_tellg: std::false_type {};
 
+template<typename Stream>
+struct _has_tellg<Stream, std::void_t<decltype(std::declval<Stream &>().tellg())>>:
+	std::true_type {};
 
-/* DECLARATIONS */
-// main
+/// Сообщает ли поток позицию от начала всего буфера (offset),
+/// если tellp считает только записанное через сам поток
+template<typename Stream, typename = void>
+struct _has_offset: std::false_type {};
+
+template<typename Stream>
+struct _has_offset<Stream, std::void_t<decltype(std::declval<Stream &>().offset())>>:
+	std::true_type {};
+
+/*! @} */
+
+
+
+
+
+
+
+
+
+
+/* VIEWS */
+/// Неизменяемое представление массива элементов T
 /*!
+ * Аналог std::span для C++17: указатель на первый элемент и
+ * их число. При десериализации из потока в памяти (см.
+ * memory_istream) указывает прямо в данные потока, которые
+ * должны жить, пока используется представление; T должен
+ * допускать побайтовое копирование (см. is_bulk_serializable)
+ */
+template<typename T>
+class span
+{
+public:
+	span() = default;
+
+	span(T const *ptr, size_t size):
+		ptr(ptr), len(size) {}
+
+	template<class Container>
+	span(Container const &cont):
+		ptr(cont.data()), len(cont.size()) {}
+
+
+
+	T const *data() const
+	{
+		return ptr;
+	}
+
+	size_t size() const
+	{
+		return len;
+	}
+
+	bool empty() const
+	{
+		return !len;
+	}
+
+	T const *begin() const
+	{
+		return ptr;
+	}
+
+	T const *end() const
+	{
+		return ptr + len;
+	}
+
+	T const &operator[](size_t i) const
+	{
+		return ptr[i];
+	}
+
+private:
+	T const *ptr = nullptr;
+	size_t   len = 0;
+};
+
+
+
+
+
+
+
+
+
+
+/* ARENA */
+/// Арена для объектов, создаваемых при десериализации
+/*!
+ * Объекты, на которые указывают обычные указатели, и
+ * динамические массивы при десериализации создаются через
+ * new по одному; если к архиву подключена арена (см.
+ * archive::set_arena), они размещаются в её блоках подряд
+ * в порядке обхода.
+ *
+ * Объекты в арене нельзя удалять через delete: все они
+ * уничтожаются (в порядке, обратном созданию) вместе с
+ * ареной или при вызове clear
+ */
+class arena
+{
+public:
+	/// \param block — размер одного блока памяти в байтах
+	explicit arena(size_t block = 64 * 1024):
+		block(block) {}
+
+	arena(arena const &) = delete;
+	arena &operator=(arena const &) = delete;
+
+	arena(arena &&other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	arena &operator=(arena &&other) noexcept
+	{
+		if(this == &other)
+			return *this;
+
+		clear();
+		blocks = std::move(other.blocks);
+		dtors  = std::move(other.dtors);
+		block  = other.block;
+		cur    = other.cur;
+		left   = other.left;
+		used   = other.used;
+
+		other.cur  = nullptr;
+		other.left = 0;
+		other.used = 0;
+		return *this;
+	}
+
+	~arena()
+	{
+		clear();
+	}
+
+
+
+	/// Выделение неинициализированной памяти
+	void *allocate(size_t size, size_t align)
+	{
+		void *p = cur;
+		if(!cur || !std::align(align, size, p, left))
+		{
+			size_t n = std::max(block, size + align);
+			blocks.emplace_back(new char[n]);
+			cur  = blocks.back().get();
+			left = n;
+			p    = cur;
+			std::align(align, size, p, left);
+		}
+
+		cur   = (char *)p + size;
+		left -= size;
+		used += size;
+		return p;
+	}
+
+	/// Аналог new T (или new T(args...))
+	template<typename T, typename...Args>
+	T *create(Args &&...args)
+	{
+		void *p = allocate(sizeof(T), alignof(T));
+
+		T *obj;
+		if constexpr(sizeof...(Args) == 0)
+			obj = ::new(p) T;
+		else
+			obj = ::new(p) T(std::forward<Args>(args)...);
+
+		if constexpr(!std::is_trivially_destructible<T>::value)
+			dtors.push_back({ &_destroy<T>, obj, 1 });
+		return obj;
+	}
+
+	/// Аналог new T[size]
+	template<typename T>
+	T *create_array(size_t size)
+	{
+		T *arr = (T *)allocate(sizeof(T) * size, alignof(T));
+		for(size_t i = 0; i < size; ++i)
+			::new(arr + i) T;
+		if constexpr(!std::is_trivially_destructible<T>::value)
+			dtors.push_back({ &_destroy<T>, arr, size });
+		return arr;
+	}
+
+
+
+	/// Уничтожение всех объектов и освобождение памяти
+	void clear()
+	{
+		for(auto it = dtors.rbegin(); it != dtors.rend(); ++it)
+			it->destroy(it->ptr, it->count);
+
+		dtors.clear();
+		blocks.clear();
+		cur  = nullptr;
+		left = 0;
+		used = 0;
+		return;
+	}
+
+	/// Число байт, выделенных под объекты
+	size_t size() const
+	{
+		return used;
+	}
+
+private:
+	template<typename T>
+	static void _destroy(void *ptr, size_t count)
+	{
+		for(size_t i = count; i > 0; --i)
+			((T *)ptr)[i - 1].~T();
+		return;
+	}
+
+	struct dtor
+	{
+		void  (*destroy)(void *, size_t);
+		void   *ptr;
+		size_t  count;
+	};
+
+	std::vector<std::unique_ptr<char[]>> blocks;
+	std::vector<dtor> dtors;
+
+	size_t block;
+	char  *cur  = nullptr;
+	size_t left = 0;
+	size_t used = 0;
+};
+
+
+
+
+
+
+
+
+
+
+/* POINTER TABLES */
+typedef int32_t id_t;
+constexpr id_t NULL_ID = std::numeric_limits<id_t>::min();
+
+/*!
+ * Таблицы, в которых архив хранит уже встреченные указатели
+ * (в режимах determine_pointers_mode и determine_shared_mode)
+ */
+
+/// Хеш-таблица с открытой адресацией
+/*!
+ * Хранит ключи и значения в двух плоских массивах (линейное
+ * пробирование, удаление сдвигом), поэтому вставка и поиск не
+ * выделяют память под каждый элемент. Ключ Empty зарезервирован
+ * под пустые ячейки и не может быть вставлен
+ */
+template<typename K, typename V, K Empty>
+class _flat_table
+{
+public:
+	/// Указатель на значение по ключу или nullptr
+	V *find(K key)
+	{
+		if(!count)
+			return nullptr;
+
+		for(size_t i = slot(key); ; i = (i + 1) & mask)
+		{
+			if(keys[i] == key)
+				return &vals[i];
+			if(keys[i] == Empty)
+				return nullptr;
+		}
+	}
+
+	/// Значение по ключу; если ключа нет, он добавляется
+	V &operator[](K key)
+	{
+		if(2 * (count + 1) > keys.size())
+			grow();
+
+		size_t i = slot(key);
+		for(; keys[i] != Empty; i = (i + 1) & mask)
+		{
+			if(keys[i] == key)
+				return vals[i];
+		}
+
+		++count;
+		keys[i] = key;
+		return vals[i] = V();
+	}
+
+	bool erase(K key)
+	{
+		if(!count)
+			return false;
+
+		size_t i = slot(key);
+		for(; keys[i] != key; i = (i + 1) & mask)
+		{
+			if(keys[i] == Empty)
+				return false;
+		}
+
+		// сдвигаем следующие элементы цепочки на освободившееся место
+		for(size_t j = (i + 1) & mask; keys[j] != Empty; j = (j + 1) & mask)
+		{
+			size_t home = slot(keys[j]);
+			if( ((j - home) & mask) >= ((j - i) & mask) )
+			{
+				keys[i] = keys[j];
+				vals[i] = std::move(vals[j]);
+				i = j;
+			}
+		}
+
+		keys[i] = Empty;
+		vals[i] = V();
+		--count;
+		return true;
+	}
+
+	size_t size() const
+	{
+		return count;
+	}
+
+private:
+	size_t slot(K key) const
+	{
+		return (size_t)( ((ullong)(uintptr_t)key * 0x9E3779B97F4A7C15ull) >> shift );
+	}
+
+	void grow()
+	{
+		std::vector<K> oldkeys(keys.empty() ? 16 : 2 * keys.size(), Empty);
+		std::vector<V> oldvals(oldkeys.size());
+		oldkeys.swap(keys);
+		oldvals.swap(vals);
+
+		mask  = keys.size() - 1;
+		shift = 64;
+		for(size_t n = keys.size(); n > 1; n >>= 1)
+			--shift;
+
+		for(size_t j = 0; j < oldkeys.size(); ++j)
+		{
+			if(oldkeys[j] == Empty)
+				continue;
+
+			size_t i = slot(oldkeys[j]);
+			while(keys[i] != Empty)
+				i = (i + 1) & mask;
+			keys[i] = oldkeys[j];
+			vals[i] = std::move(oldvals[j]);
+		}
+
+		return;
+	}
+
+	std::vector<K> keys;
+	std::vector<V> vals;
+	size_t count = 0;
+	size_t mask  = 0;
+	int    shift = 64;
+};
+
+
+
+/// Уникальный для каждого типа адрес, которым помечаются
+/// записи таблицы идентификаторов
+template<typename T>
+struct _type_tag
+{
+	static constexpr char tag = 0;
+};
+
+/// Объект, сопоставленный идентификатору
+struct _id_entry
+{
+	void       *ptr  = nullptr;
+	void const *type = nullptr; // &_type_tag<T>::tag
+
+	/// Владение объектом, если он получен через std::shared_ptr
+	std::shared_ptr<void> shared;
+
+	/// Указатель типа T; при несовпадении типа бросается исключение
+	template<typename T>
+	T get() const
+	{
+		if(type != &_type_tag<T>::tag)
+			throw "Pointer type does not match the type it was stored with";
+		return (T)ptr;
+	}
+
+	template<typename T>
+	std::shared_ptr<T> get_shared() const
+	{
+		if(type != &_type_tag<std::shared_ptr<T>>::tag)
+			throw "Pointer type does not match the type it was stored with";
+		return std::static_pointer_cast<T>(shared);
+	}
+};
+
+/// Сопоставление идентификаторов объектам
+/*!
+ * Идентификаторы, которые раздаёт сам архив, идут подряд с
+ * нуля, поэтому хранятся в массиве с прямой адресацией;
+ * остальные (например, идентификаторы Лиры) — в хеш-таблице.
+ * Массив растёт не дальше удвоенного числа занятых в нём
+ * мест, поэтому редкие большие идентификаторы из потока не
+ * раздувают его.
+ * Идентификатор, попавший в хеш-таблицу, может позже оказаться
+ * внутри выросшего массива; он переносится в массив при
+ * следующем обращении через operator[], а до того ищется в
+ * хеш-таблице
+ */
+class _id_table
+{
+public:
+	_id_entry *find(id_t id)
+	{
+		if(id >= 0 && (size_t)id < dense.size() && dense[id].type)
+			return &dense[id];
+		return sparse.size() ? sparse.find(id) : nullptr;
+	}
+
+	_id_entry &operator[](id_t id)
+	{
+		if(id >= 0 && ((size_t)id < dense.size() || (size_t)id <= 2 * used + 64))
+		{
+			if((size_t)id >= dense.size())
+				dense.resize(id + 1);
+
+			if(!dense[id].type)
+			{
+				++used;
+				if(_id_entry *moved = sparse.size() ? sparse.find(id) : nullptr)
+				{
+					dense[id] = std::move(*moved);
+					sparse.erase(id);
+				}
+			}
+			return dense[id];
+		}
+		return sparse[id];
+	}
+
+	bool erase(id_t id)
+	{
+		bool had = false;
+		if(id >= 0 && (size_t)id < dense.size())
+		{
+			had = dense[id].type;
+			used -= had;
+			dense[id] = _id_entry();
+		}
+		return sparse.erase(id) || had;
+	}
+
+private:
+	std::vector<_id_entry> dense;
+	size_t used = 0; // занятые места в dense
+	_flat_table<id_t, _id_entry, NULL_ID> sparse;
+};
+
+
+
+
+
+
+
+
+
+
+/* BYTE ORDER */
+/// Порядок байт машины — от старшего к младшему
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool _native_big_endian = true;
+#else
+constexpr bool _native_big_endian = false;
+#endif
+
+/*!
+ * Разворот байт в count элементах размера N: из src в dst
+ * (src и dst могут совпадать). Для массивов используются
+ * инструкции pshufb из SSSE3 или AVX2, если процессор их
+ * поддерживает
+ */
+template<size_t N>
+inline void _byteswap_scalar(char *dst, char const *src, size_t count)
+{
+	for(size_t i = 0; i < count; ++i, dst += N, src += N)
+	{
+		char tmp[N];
+		for(size_t k = 0; k < N; ++k)
+			tmp[k] = src[N - 1 - k];
+		std::memcpy(dst, tmp, N);
+	}
+}
+
+#ifdef NVX_BYTESWAP_SIMD
+inline bool _has_ssse3()
+{
+	static bool const has = [] {
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("ssse3");
+	}();
+	return has;
+}
+
+inline bool _has_avx2()
+{
+	static bool const has = [] {
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+	}();
+	return has;
+}
+
+template<size_t N>
+__attribute__((target("ssse3")))
+void _byteswap_ssse3(char *dst, char const *src, size_t count)
+{
+	char m[16];
+	for(size_t i = 0; i < 16; ++i)
+		m[i] = (char)(i / N * N + N - 1 - i % N);
+	__m128i mask = _mm_loadu_si128((__m128i const *)m);
+
+	size_t n = count * N, i = 0;
+	for(; i + 16 <= n; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((__m128i const *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(v, mask));
+	}
+
+	_byteswap_scalar<N>(dst + i, src + i, (n - i) / N);
+}
+
+template<size_t N>
+__attribute__((target("avx2")))
+void _byteswap_avx2(char *dst, char const *src, size_t count)
+{
+	char m[16];
+	for(size_t i = 0; i < 16; ++i)
+		m[i] = (char)(i / N * N + N - 1 - i % N);
+	__m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)m));
+
+	size_t n = count * N, i = 0;
+	for(; i + 64 <= n; i += 64)
+	{
+		__m256i a = _mm256_loadu_si256((__m256i const *)(src + i));
+		__m256i b = _mm256_loadu_si256((__m256i const *)(src + i + 32));
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(a, mask));
+		_mm256_storeu_si256((__m256i *)(dst + i + 32), _mm256_shuffle_epi8(b, mask));
+	}
+	for(; i + 32 <= n; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((__m256i const *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(v, mask));
+	}
+
+	_byteswap_scalar<N>(dst + i, src + i, (n - i) / N);
+}
+#endif
+
+template<size_t N>
+inline void _byteswap_range(char *dst, char const *src, size_t count)
+{
+#ifdef NVX_BYTESWAP_SIMD
+	if constexpr(16 % N == 0)
+	{
+		if(count * N >= 32 && _has_avx2())
+			return _byteswap_avx2<N>(dst, src, count);
+		if(count * N >= 16 && _has_ssse3())
+			return _byteswap_ssse3<N>(dst, src, count);
+	}
+#endif
+
+	_byteswap_scalar<N>(dst, src, count);
+}
+
+
+
+
+
+
+
+
+
+
+/* ARCHIVE */
+
+/// Перечисление, которое отвечает за режим работы архива;
+/// режими можно комбинировать с помощью оператора |
+enum ArchiveMode
+{
+	/// Ничего не сохранять, не проверять
+	/*!
+	 * Никакие указатели не сохраняются и не проверяются
+	 */
+	none_mode = 0,
+
+	/// Режим поддержки разделяемых обычных указателей
+	/*!
+	 * Обычные указатели сохраняются и ассоциируются с
+	 * уникальными идентификаторами. Если в дальнейшем потребуется
+	 * десериализовать указатель, который уже встречался,
+	 * то возвратится сохранённый указатель
+	 */
+	determine_pointers_mode = 1 << 0,
+
+	/// Режим поддержки разделяемых (std::shared_ptr) указателей
+	/*!
+	 * Указатели std::shared_ptr сохраняются и ассоциируются с
+	 * уникальными идентификаторами. Если в дальнейшем потребуется
+	 * десериализовать указатель, который уже встречался,
+	 * то возвратится сохранённый указатель. (Режим по умолчанию)
+	 */
+	determine_shared_mode   = 1 << 1,
+
+	/// Режим сжатого представления целых чисел
+	/*!
+	 * Целые числа размером больше одного байта (в том числе
+	 * размеры контейнеров и массивов и идентификаторы указателей)
+	 * записываются в формате varint (LEB128): по 7 бит в байте,
+	 * знаковые — после zigzag-преобразования; небольшие по модулю
+	 * значения занимают один-два байта. Плоские структуры
+	 * по-прежнему записываются как есть
+	 */
+	varint_mode             = 1 << 2,
+
+	/// Режим разностного кодирования ключей
+	/*!
+	 * Целочисленные ключи упорядоченных по возрастанию контейнеров
+	 * (set, multiset, map, multimap с std::less) записываются в
+	 * формате varint как разность с предыдущим ключом (первый
+	 * ключ — как есть, после zigzag-преобразования); для плотных
+	 * возрастающих ключей это обычно один байт на ключ
+	 */
+	delta_mode              = 1 << 3,
+
+	/// Режим сохранения геометрии хеш-таблиц
+	/*!
+	 * Для unordered-контейнеров перед элементами записываются
+	 * число корзин (bucket_count) и max_load_factor, и при
+	 * десериализации таблица строится сразу с исходной
+	 * геометрией; без этого режима при десериализации место
+	 * резервируется под все элементы сразу (reserve). Заранее
+	 * таблица готовится не больше чем под HASH_BUCKETS_LIMIT
+	 * элементов (см. там же), дальше она растёт при вставке
+	 */
+	hash_geometry_mode      = 1 << 4,
+
+	/// Режим обхода указателей без рекурсии
+	/*!
+	 * Объекты, на которые указывают обычные, unique и shared
+	 * указатели, записываются не сразу за указателем, а
+	 * ставятся в очередь, которая обрабатывается циклом
+	 * (обход в ширину), поэтому глубина цепочек указателей
+	 * (списки, вырожденные деревья) ограничена только
+	 * памятью, а не стеком. Меняет формат: читать нужно в
+	 * том же режиме. С Лирой не используется.
+	 *
+	 * Объекты из очереди читаются раньше тех, на которые они
+	 * сами указывают, поэтому их after_deserialization (из
+	 * NVX_SERIALIZABLE) и вставка элементов в set, map и
+	 * unordered-контейнеры откладываются до конца обхода и
+	 * выполняются в порядке чтения. Собственные функции
+	 * deserialize, вызывающие что-то подобное сами, видят
+	 * указываемые объекты ещё не прочитанными
+	 */
+	iterative_mode          = 1 << 5,
+
+	/// Режим записи контейнеров частями
+	/*!
+	 * Вместо общего размера контейнер записывается
+	 * последовательностью частей (размер части, затем её
+	 * элементы) с завершающей частью нулевого размера, так
+	 * что его можно писать и читать, не зная размера заранее
+	 * (см. container_writer и container_reader). Строки
+	 * записываются как обычно. В части не больше CHUNK_ELEMENTS
+	 * элементов; с режимами delta_mode и hash_geometry_mode не
+	 * сочетается (конструктор архива бросает исключение)
+	 */
+	chunked_mode            = 1 << 6,
+
+	/// Режим выравнивания массивов
+	/*!
+	 * Перед элементами vector и span, которые записываются
+	 * одним блоком, вставляются нулевые байты, чтобы блок
+	 * начинался с позиции потока, кратной alignof элемента.
+	 * Тогда при чтении из выровненного буфера в памяти к
+	 * элементам можно обращаться напрямую (см. span). Поток
+	 * должен сообщать позицию (tellp, tellg); buffer_ostream,
+	 * дописывающий в непустую строку (serialize_append),
+	 * выравнивает по позиции в самой строке. При подсчёте
+	 * размера без записи (write = false) учитывается
+	 * наибольшее возможное выравнивание
+	 */
+	aligned_mode            = 1 << 7,
+
+	/// Режимы фиксированного порядка байт
+	/*!
+	 * Числа (фундаментальные типы размером больше одного
+	 * байта, в том числе размеры контейнеров) записываются
+	 * в порядке от младшего байта к старшему (little_endian_mode)
+	 * или наоборот (big_endian_mode), так что архив читается на
+	 * машине с любым порядком байт. Если порядок совпадает с
+	 * порядком машины, режим ничего не стоит; иначе массивы
+	 * переворачиваются векторными инструкциями, а span и
+	 * string_view из многобайтовых элементов читать нельзя.
+	 * Целые числа в режиме varint_mode от порядка байт не
+	 * зависят. Плоские структуры (NVX_SERIALIZABLE_PLAIN)
+	 * по-прежнему записываются как есть, в порядке байт
+	 * машины. Указывается не больше одного из двух режимов,
+	 * иначе конструктор архива бросает исключение
+	 */
+	little_endian_mode      = 1 << 8,
+	big_endian_mode         = 1 << 9
+};
+
+/// Число элементов в одной части контейнера в режиме chunked_mode
+constexpr int32_t CHUNK_ELEMENTS = 1 << 12;
+
+/// Число элементов, под которое хеш-таблица готовится заранее
+/// при любом размере, считанном из потока (больше — только
+/// если столько байт действительно осталось в потоке); число
+/// корзин из hash_geometry_mode ограничивается большим из
+/// HASH_BUCKETS_LIMIT и двух корзин на такой элемент
+constexpr ullong HASH_BUCKETS_LIMIT = 1 << 12;
+
+/// Размер, которым начинается контейнер, записанный вместе
+/// с таблицей смещений частей (см. serialize_indexed)
+constexpr int32_t INDEXED_MARK = -1;
+
+/// Значение параметра Mode архива, при котором режим
+/// задаётся при создании архива (см. archive)
+constexpr int runtime_mode = -1;
+
+
+
+#ifdef NVX_SERIALIZATION_STATS
+/// Статистика работы архива (см. archive::stats)
+/*!
+ * Собирается, только если перед подключением библиотеки
+ * определён макрос NVX_SERIALIZATION_STATS (одинаково во
+ * всех единицах трансляции программы); без него архив не
+ * хранит и не считает ничего лишнего. Разные определения
+ * archive в одной программе нарушают ODR; в GCC и Clang
+ * архив со статистикой помечается abi_tag, и функции,
+ * принимающие архив из единиц с разным режимом, не
+ * компонуются вместе.
+ *
+ * Для каждой категории объектов считается число вызовов
+ * (де)сериализации и число прошедших через поток байт,
+ * вместе с вложенными объектами, поэтому байты элементов
+ * контейнера учитываются и в категории элементов, и в
+ * категории контейнера. Элементы, которые копируются одним
+ * блоком, по отдельности не учитываются. Подсчёт размера
+ * без записи (write = false) в статистику не попадает
+ */
+struct archive_stats
+{
+	struct category
+	{
+		ullong calls = 0;
+		ullong bytes = 0;
+	};
+
+	category fundamental; ///< Числа и символы
+	category plain;       ///< Плоские структуры (NVX_SERIALIZABLE_PLAIN)
+	category object;      ///< Структуры с NVX_SERIALIZABLE
+	category container;   ///< Контейнеры и строки
+	category pointer;     ///< Обычные указатели и std::unique_ptr
+	category shared;      ///< std::shared_ptr и std::weak_ptr
+
+	/// Найденные (hits) и новые (misses) объекты в таблицах
+	/// указателей (determine_pointers_mode, determine_shared_mode)
+	ullong hits   = 0;
+	ullong misses = 0;
+
+	/// Обращения к потоку и переданные в них байты
+	ullong writes  = 0;
+	ullong reads   = 0;
+	ullong written = 0;
+	ullong read    = 0;
+
+	/// Время работы операторов << и >> в секундах
+	double seconds = 0;
+};
+
+// Учёт одного вызова (де)сериализации категории c: при
+// выходе из области к ней добавляются байты, прошедшие за
+// это время через поток
+template<class Archive>
+class _stats_scope
+{
+public:
+	_stats_scope(Archive &a, archive_stats::category archive_stats::*c, bool on = true):
+		st(on ? &a.st : nullptr), c(c), start(on ? a.st.written + a.st.read : 0) {}
+
+	_stats_scope(_stats_scope const &) = delete;
+	_stats_scope &operator=(_stats_scope const &) = delete;
+
+	static archive_stats &of(Archive &a)
+	{
+		return a.st;
+	}
+
+	~_stats_scope()
+	{
+		if(!st)
+			return;
+		++(st->*c).calls;
+		(st->*c).bytes += st->written + st->read - start;
+		return;
+	}
+
+private:
+	archive_stats *st;
+	archive_stats::category archive_stats::*c;
+	ullong start;
+};
+
+#define _NVX_STATS_SCOPE(a, cat, on) \
+	nvx::_stats_scope<std::remove_reference_t<decltype(a)>> \
+		_nvx_stats_scope(a, &nvx::archive_stats::cat, on)
+#define _NVX_STATS_ADD(a, field, n) \
+	(nvx::_stats_scope<std::remove_reference_t<decltype(a)>>::of(a).field += (n))
+#else
+#define _NVX_STATS_SCOPE(a, cat, on)
+#define _NVX_STATS_ADD(a, field, n)
+#endif
+
+
+
+template<typename T>
+class Lira;
+
+/// Может ли архив с параметром Mode различать указатели
+constexpr bool _tracking_mode(int Mode)
+{
+	return Mode == runtime_mode ||
+		(Mode & (determine_pointers_mode | determine_shared_mode));
+}
+
+// Проверка, что режимы архива не противоречат друг другу
+inline void _check_mode(int mode)
+{
+	if((mode & little_endian_mode) && (mode & big_endian_mode))
+		throw "little_endian_mode and big_endian_mode are mutually exclusive";
+	if((mode & chunked_mode) && (mode & (delta_mode | hash_geometry_mode)))
+		throw "chunked_mode can't be combined with delta_mode or hash_geometry_mode";
+}
+
+// Режим архива: хранится в самом архиве (runtime_mode)
+// или известен на этапе компиляции
+template<int Mode>
+struct _archive_mode
+{
+	_archive_mode(int mode)
+	{
+		if(mode != Mode)
+			throw "Archive mode differs from its Mode parameter";
+		_check_mode(mode);
+	}
+
+	static constexpr int mode = Mode;
+};
+
+template<>
+struct _archive_mode<runtime_mode>
+{
+	_archive_mode(int mode):
+		mode(mode)
+	{
+		_check_mode(mode);
+	}
+
+	int mode;
+};
+
+// Таблицы указателей и связь с Лирой; архивы, которые
+// не различают указатели, их не хранят
+template<typename Meta, bool Tracking>
+struct _archive_tables
+{
+	static constexpr Lira<Meta> *lira = nullptr;
+};
+
+template<typename Meta>
+struct _archive_tables<Meta, true>
+{
+	// Сопоставление каждому идентификатору объекту в ОП
+	_id_table idns;
+
+	// Сопоставление каждому объекту в ОП идентификатора
+	// и числу указывающих на него объектов
+	_flat_table<void const *, std::pair<id_t, int>, nullptr> objs;
+
+	Lira<Meta> *lira = nullptr;
+
+	int freshness = 0;
+	int curid     = 0;
+	int incid     = 0;
+};
+
+/// Класс архива, необходимый для (де)сериализации
+/*!
+ * Указатели сохраняются только в пределах класса archive.
+ *
+ * \param Stream — класс потока, использующийся для
+ * (де)сериализации, например, ostream или istream,
+ * также stringstream; класс должен иметь следующие методы:
+ * - operator bool()
+ * - write( char const *, size_t )
+ * - read( char *, size_t )
+ * - tellp, seekp, tellg, seekg (нужны только при работе с Лирой)
+ *
+ * Для быстрой записи в память используются потоки
+ * buffer_ostream и staging_ostream (см. \ref streams)
+ *
+ * \param Meta — в случае если используется Lira,
+ * соответствует типу её метаобъектов; иначе не
+ * имеет смысла
+ *
+ * \param Mode — режим архива (см. ArchiveMode), известный
+ * на этапе компиляции; тогда все проверки режима
+ * вычисляются компилятором, а архив, не различающий
+ * указатели, не хранит таблиц указателей и не может
+ * работать с Лирой. По умолчанию (runtime_mode) режим
+ * передаётся конструктору
+ */
+template<class Stream, typename Meta = void, int Mode = runtime_mode>
+class NVX_SERIALIZATION_ABI archive:
+	private _archive_mode<Mode>,
+	private _archive_tables<Meta, _tracking_mode(Mode)>
+{
+public:
+
+	/// Конструктор по умолчанию
+	/*!
+	 * Если режим задан параметром Mode, то mode можно не
+	 * указывать, а указанный должен с ним совпадать
+	 */
+	archive(Stream *s, int mode = Mode == runtime_mode ? determine_shared_mode : Mode):
+		_archive_mode<Mode>(mode), s(s) {}
+
+
+
+	/// Получения потока
+	Stream *stream() const
+	{
+		return s;
+	}
+
+
+
+	/// Сериализация с опомщью оператора <<
+	template<typename T>
+	archive &operator<<(T t)
+	{
+		if(!s)
+			return *this;
+#ifdef NVX_SERIALIZATION_STATS
+		auto start = std::chrono::steady_clock::now();
+		serialize(*this, t);
+		st.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#else
+		serialize(*this, t);
+#endif
+		return *this;
+	}
+
+	/// Десериализация с помощью оператора >>
+	template<typename T>
+	archive &operator>>(T t)
+	{
+		if(!s)
+			return *this;
+#ifdef NVX_SERIALIZATION_STATS
+		auto start = std::chrono::steady_clock::now();
+		deserialize(*this, t);
+		st.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#else
+		deserialize(*this, t);
+#endif
+		return *this;
+	}
+
+	/// Проверка потока на работоспособность
+	operator bool() const
+	{
+		return s && (bool)*s;
+	}
+
+	/// Режим архива (см. ArchiveMode)
+	int get_mode() const
+	{
+		return this->mode;
+	}
+
+	/// Число объектов, получивших идентификаторы (в режимах
+	/// determine_pointers_mode и determine_shared_mode)
+	size_t tracked() const
+	{
+		if constexpr(_tracking_mode(Mode))
+			return this->objs.size();
+		return 0;
+	}
+
+#ifdef NVX_SERIALIZATION_STATS
+	/// Статистика, собранная с момента создания архива или
+	/// последнего вызова reset_stats (см. archive_stats)
+	archive_stats const &stats() const
+	{
+		return st;
+	}
+
+	/// Обнуление статистики
+	void reset_stats()
+	{
+		st = archive_stats();
+		return;
+	}
+#endif
+
+
+
+	/// Подключение внешней арены (nullptr — отключение)
+	/*!
+	 * Объекты, создаваемые при десериализации обычных указателей
+	 * и динамических массивов, будут размещаться в арене и
+	 * принадлежать ей
+	 */
+	void set_arena(nvx::arena *a)
+	{
+		ar = a;
+		own.reset();
+		return;
+	}
+
+	/// Подключение собственной арены архива
+	nvx::arena *enable_arena(size_t block = 64 * 1024)
+	{
+		own.reset(new nvx::arena(block));
+		ar = own.get();
+		return ar;
+	}
+
+	/// Текущая арена или nullptr
+	nvx::arena *get_arena() const
+	{
+		return ar;
+	}
+
+	/// Передача собственной арены (вместе со всеми
+	/// созданными в ней объектами) вызывающему
+	std::unique_ptr<nvx::arena> release_arena()
+	{
+		ar = nullptr;
+		return std::move(own);
+	}
+
+
+
+	/// Подключение ресурса памяти (nullptr — отключение)
+	/*!
+	 * Объекты, которые архив создаёт сам (на которые указывают
+	 * обычные, unique и shared указатели), конструируются с
+	 * std::pmr::polymorphic_allocator над этим ресурсом, если
+	 * их тип поддерживает аллокаторы; shared-объекты вместе со
+	 * счётчиком ссылок размещаются в самом ресурсе.
+	 *
+	 * Элементы контейнеров всегда создаются с аллокатором
+	 * самого контейнера, так что pmr-контейнер, построенный
+	 * над тем же ресурсом, заполняется только из него
+	 */
+	void set_memory_resource(std::pmr::memory_resource *r)
+	{
+		mr = r;
+		return;
+	}
+
+	/// Текущий ресурс памяти или nullptr
+	std::pmr::memory_resource *get_memory_resource() const
+	{
+		return mr;
+	}
+
+
+
+private:
+	friend class nvx::Lira<Meta>;
+
+	using _archive_mode<Mode>::mode;
+	using _archive_tables<Meta, _tracking_mode(Mode)>::lira;
+
+	Stream *s;
+
+	nvx::arena *ar = nullptr;
+	std::unique_ptr<nvx::arena> own;
+
+	std::pmr::memory_resource *mr = nullptr;
+
+	// Очередь отложенных объектов в режиме iterative_mode
+	struct task
+	{
+		int (*run)(archive &, void *, bool);
+		void *obj;
+		bool  write;
+	};
+
+	std::deque<task> tasks;
+	bool traversing = false;
+
+	// Действия, отложенные до конца обхода очереди
+	// (см. _defer_after_deserialization)
+	struct deferred_task
+	{
+		void (*run)(void *);
+		void *obj;
+		std::shared_ptr<void> own; // владеет obj, если он создан для задачи
+	};
+
+	std::vector<deferred_task> deferred;
+
+#ifdef NVX_SERIALIZATION_STATS
+	archive_stats st;
+
+	template<class A>
+	friend class _stats_scope;
+#endif
+
+	id_t newid()
+	{
+		if(lira)
+			return lira->next_shared_id();
+		return this->incid++;
+	}
+
+
+
+	// Все функции (де)сериализации обращаются
+	// к потоку только через эти две функции
+	inline bool _write(char const *data, size_t n)
+	{
+		_NVX_STATS_ADD(*this, writes, 1);
+		_NVX_STATS_ADD(*this, written, n);
+		s->write(data, n);
+		return (bool)*s;
+	}
+
+	inline bool _read(char *data, size_t n)
+	{
+		_NVX_STATS_ADD(*this, reads, 1);
+		_NVX_STATS_ADD(*this, read, n);
+		s->read(data, n);
+		return (bool)*s;
+	}
+
+	// Позиционирование нужно только при работе с Лирой,
+	// поэтому потоки без seekp и seekg тоже допустимы
+	inline int _tellp()
+	{
+		if constexpr(_has_seekp<Stream>::value)
+			return s->tellp();
+		return 0;
+	}
+
+	inline void _seekp(int p)
+	{
+		if constexpr(_has_seekp<Stream>::value)
+			s->seekp(p);
+		return;
+	}
+
+	inline int _tellg()
+	{
+		if constexpr(_has_seekg<Stream>::value)
+			return s->tellg();
+		return 0;
+	}
+
+	inline void _seekg(int p)
+	{
+		if constexpr(_has_seekg<Stream>::value)
+			s->seekg(p);
+		return;
+	}
+
+
+
+	// pointers
+	template<class Ostream, typename M, int Md, typename T>
+	friend int _serialize_dispatcher(
+		archive<Ostream, M, Md> &os,
+		T const *obj,
+		std::true_type,
+		bool write
+	);
+
+	template<class Ostream, typename M, int Md, typename T>
+	friend int _deserialize_dispatcher(
+		archive<Ostream, M, Md> &os,
+		T *obj,
+		std::true_type
+	);
+
+	template<class S, typename M, int Md, typename T>
+	friend int _serialize_pointee(archive<S, M, Md> &os, T const *obj, bool write);
+
+	template<class S, typename M, int Md, typename T>
+	friend int _deserialize_pointee(archive<S, M, Md> &is, T *obj);
+
+	template<class S, typename M, int Md>
+	friend int _run_tasks(archive<S, M, Md> &a);
+
+	template<class S, typename M, int Md>
+	friend bool _traversing(archive<S, M, Md> const &a);
+
+	template<class S, typename M, int Md, typename T>
+	friend bool _defer_after_deserialization(archive<S, M, Md> &is, T *obj);
+
+	template<class S, typename M, int Md, class Cont>
+	friend int _deserialize_inserted_elements(archive<S, M, Md> &is, Cont *cont, int32_t size);
+
+	template<typename T, class S, typename M, int Md>
+	friend T *_new_object(archive<S, M, Md> &is, bool inarena);
+
+	template<typename T, class S, typename M, int Md>
+	friend std::shared_ptr<T> _new_shared(archive<S, M, Md> &is);
+
+	template<typename T, class S, typename M, int Md>
+	friend T *_new_array(archive<S, M, Md> &is, size_t size);
+
+
+	// shared prointers
+	template<class Ostream, typename M, int Md, typename T>
+	friend int serialize(
+		archive<Ostream, M, Md> &os,
+		std::shared_ptr<T> const *obj,
+		bool write
+	);
+
+	template<class Ostream, typename M, int Md, typename T>
+	friend int serialize(
+		archive<Ostream, M, Md> &os,
+		std::shared_ptr<T> const *obj,
+		bool write
+	);
+
+	template<class Istream, typename M, int Md, typename T>
+	friend int deserialize(
+		archive<Istream, M, Md> &is,
+		std::shared_ptr<T> *obj
+	);
+
+
+	// final
+	template<class Ostream, typename M, int Md, typename T>
+	friend int _serialize_final(
+		archive<Ostream, M, Md> &os,
+		T const *value,
+		std::true_type isfundamental,
+		bool write
+	);
+
+	template<class Istream, typename M, int Md, typename T>
+	friend int _deserialize_final(
+		archive<Istream, M, Md> &is,
+		T *value,
+		std::true_type isfundamental
+	);
+
+
+	// plain
+	template<class Ostream, typename M, int Md>
+	friend int serialize_plain(
+		archive<Ostream, M, Md> &os,
+		void const *obj,
+		int size,
+		bool write
+	);
+
+	template<class Istream, typename M, int Md>
+	friend int deserialize_plain(
+		archive<Istream, M, Md> &is,
+		void *obj,
+		int size
+	);
+
+
+	// ranges
+	template<class S, typename M, int Md>
+	friend bool _has_mode(archive<S, M, Md> const &a, int flag);
+
+	template<typename T, class S, typename M, int Md>
+	friend bool _bulk_enabled(archive<S, M, Md> const &a);
+
+	template<typename T, class S, typename M, int Md>
+	friend bool _fixed_enabled(archive<S, M, Md> const &a);
+
+	template<class Ostream, typename M, int Md, typename T>
+	friend int _serialize_range(
+		archive<Ostream, M, Md> &os,
+		T const *value,
+		size_t size,
+		bool write
+	);
+
+	template<class Istream, typename M, int Md, typename T>
+	friend int _deserialize_range(
+		archive<Istream, M, Md> &is,
+		T *value,
+		size_t size
+	);
+
+
+	// varint
+	template<class Ostream, typename M, int Md, typename U>
+	friend int _serialize_varint(
+		archive<Ostream, M, Md> &os,
+		U value,
+		bool write
+	);
+
+	template<class Istream, typename M, int Md, typename U>
+	friend int _deserialize_varint(
+		archive<Istream, M, Md> &is,
+		U *value
+	);
+};
+
+
+
+
+
+
+
+
+
+
+/* MACROS */
+/********************** HELP FOR MACROS *********************/
+/*
+ * Следующие структуры и функции обспечивают работу
+ * макросов, которые включаются внутрь сериализуемых
+ * классов и структур
+ */
+
+/*!
+ * Структура, представляющая сериализуемый динамический
+ * массив; необходимо обратить внимание на то, что размер
+ * всегда должен быть указателем на тип int
+ */
+template<typename T>
+struct _serializable_dynamic_array_type
+{
+	T ptr;
+	int *size;
+};
+
+/*!
+ * Структура, представляющая статический массив; при
+ * сериализации статического массива в начало данных
+ * не передаётся их размер
+ */
+template<typename T>
+struct _serializable_static_array_type
+{
+	T ptr;
+	int const SIZE;
+};
+
+
+
+// serialize cascade
+/*!
+ * Сериазизация нескольких элементов разного типа
+ * (в том числе динамических и статических массивов, но
+ * дле этого их нужно обернуть в соответствующие структуры
+ * или использовать для этого соответствующие макросы)
+ */
+template<class Ostream, typename Meta, int Mode>
+inline int serialize_elements(
+	archive<Ostream, Meta, Mode> &os,
+	bool write = true
+)
+{
+	return 0;
+}
+
+template<class Ostream, typename Meta, int Mode, typename T, typename...Args>
+inline int serialize_elements(
+	archive<Ostream, Meta, Mode> &os, bool write,
+	_serializable_dynamic_array_type<T> arr,
+	Args...args
+)
+{
+	return serialize_array(os, arr.ptr, arr.size, write) +
+		   serialize_elements(os, write, args...);
+}
+
+template<class Ostream, typename Meta, int Mode, typename T, typename...Args>
+inline int serialize_elements(
+	archive<Ostream, Meta, Mode> &os, bool write,
+	_serializable_static_array_type<T> arr,
+	Args...args
+)
+{
+	return serialize_static(os, arr.ptr, arr.SIZE, write) +
+		   serialize_elements(os, write, args...);
+}
+
+template<class Ostream, typename Meta, int Mode, typename Head, typename...Args>
+inline int serialize_elements(
+	archive<Ostream, Meta, Mode> &os,
+	bool write,
+	Head head,
+	Args...args
+)
+{
+	return serialize(os, head, write) +
+		serialize_elements(os, write, args...);
+}
+
+
+
+// deserialize cascade
+/*!
+ * Десериализация нескольких элементов разного типа
+ * (в том числе динамических и статических массивов, но
+ * дле этого их нужно обернуть в соответствующие структуры
+ * или использовать для этого соответствующие макросы)
+ */
+template<class Istream, typename Meta, int Mode>
+inline int deserialize_elements(archive<Istream, Meta, Mode> &is)
+{
+	return 0;
+}
+
+template<class Istream, typename Meta, int Mode, typename T, typename...Args>
+inline int deserialize_elements(
+	archive<Istream, Meta, Mode> &is,
+	_serializable_dynamic_array_type<T> arr,
+	Args...args
+)
+{
+	return deserialize_array(is, arr.ptr, arr.size) +
+		   deserialize_elements(is, args...);
+}
+
+template<class Istream, typename Meta, int Mode, typename T, typename...Args>
+inline int deserialize_elements(
+	archive<Istream, Meta, Mode> &is,
+	_serializable_static_array_type<T> arr,
+	Args...args
+)
+{
+	return deserialize_static(is, arr.ptr, arr.SIZE) +
+		   deserialize_elements(is, args...);
+}
+
+template<class Istream, typename Meta, int Mode, typename Head, typename...Args>
+inline int deserialize_elements(archive<Istream, Meta, Mode> &is, Head head, Args...args)
+{
+	return deserialize(is, head) + deserialize_elements(is, args...);
+}
+
+
+
+
+
+/************************** ARRAYS **************************/
+/*!
+ * Макросы для сериализации динамических и статических массив;
+ * в макросы передаются два параметра: массив и размер; существуют
+ * существенные отличия между динамическими и статическими массивами:
+ *
+ *   1. В качестве данных в динамеческом массиве выступает указатель
+ *      на массив (то есть указатель на указатель на тип данных масива) —
+ *      это используется для того, чтобы автоматически выделить необхо-
+ *      димое количество памяти; в то время как для статического массива
+ *      указывается сам массив без взятия адреса
+ *
+ *   2. При сериализации динамического массива указывается указатель на
+ *      переменную содержащую размер (всегда int *), для того, чтобы
+ *      при сериализации узнать число элементов и при десериализации
+ *      записать его; в статическом массиве указывается непосредственно
+ *      целое число (будет представлено как int)
+ */
+#define NVX_SERIALIZABLE_DYNAMIC_ARRAY(ptr, sizeptr) \
+	nvx::_serializable_dynamic_array_type< \
+		typename std::remove_reference<decltype(**ptr)>::type ** \
+	> { \
+		(typename std::remove_reference<decltype(**ptr)>::type **)ptr, \
+		(typename std::remove_const< \
+		 	typename std::remove_reference<decltype(*sizeptr) \
+		>::type>::type *)sizeptr \
+	}
+
+#define NVX_SERIALIZABLE_STATIC_ARRAY(ptr, size) \
+	nvx::_serializable_static_array_type< \
+		typename std::remove_reference<decltype(*ptr)>::type * \
+	> { \
+		ptr, size \
+	}
+
+
+
+/************************* IN-STRUCT ************************/
+/*!
+ * Эти макросы используется в теле класса или структуры, чтобы
+ * сделать его сериализуемым; в качестве аргументов укызавыается:
+ *
+ *   - Указатели на сериализуемые объекты (фундаментальные типы,
+ *     строки, сериализуемые структуры, в том числе стандартные
+ *     контейнеры)
+ *
+ *   - Динамические массивы (используется макрос
+ *     NVX_SERIALIZABLE_DYNAMIC_ARRAY(ptr, sizeptr))
+ *
+ *   - Статические массивы (используется макрос
+ *     NVX_SERIALIZABLE_STATIC_ARRAY(ptr, size))
+ *
+ * Если необходимо совершить действия после сериализации или
+ * десериализации, то объявляются методы класса или структуры с
+ * именами after_serialization() и after_deserialization()
+ * соответственно
+ */
+
+#define NVX_SERIALIZABLE(...) \
+public: \
+	auto _nvx_elements() \
+	{ \
+		return nvx::_elements_list_of(__VA_ARGS__); \
+	} \
+ \
+	template<typename Ostream, typename _nvx_meta, int _nvx_mode> \
+	int serialize(nvx::archive<Ostream, _nvx_meta, _nvx_mode> &os, bool write = true) const \
+	{ \
+		int res = nvx::serialize_elements( os, write, __VA_ARGS__ ); \
+		after_serialization(); \
+		return res; \
+	} \
+ \
+	template<typename Istream, typename _nvx_meta, int _nvx_mode> \
+	int deserialize(nvx::archive<Istream, _nvx_meta, _nvx_mode> &is) \
+	{ \
+		int res = nvx::deserialize_elements( is, __VA_ARGS__ ); \
+		if(!nvx::_defer_after_deserialization(is, this)) \
+			after_deserialization(); \
+		return res; \
+	}
+
+/*!
+ * Используется этот макрос, если структура данных является
+ * плоской. Такая структура копируется как есть, в порядке
+ * байт машины, в том числе в режимах little_endian_mode и
+ * big_endian_mode; если архив должен читаться на машине с
+ * другим порядком байт, используется NVX_SERIALIZABLE
+ */
+#define NVX_SERIALIZABLE_PLAIN() \
+public: \
+	auto _nvx_plain_self() const -> \
+		std::remove_cv_t<std::remove_reference_t<decltype(*this)>>; \
+ \
+	template<class Ostream, typename _nvx_meta, int _nvx_mode> \
+	inline int serialize(nvx::archive<Ostream, _nvx_meta, _nvx_mode> &os, bool write = true) const \
+	{ \
+		int res = nvx::serialize_plain(os, (void const *)this, sizeof(*this), write); \
+		after_serialization(); \
+		return res; \
+	} \
+ \
+	template<class Istream, typename _nvx_meta, int _nvx_mode> \
+	inline int deserialize(nvx::archive<Istream, _nvx_meta, _nvx_mode> &is) \
+	{ \
+		int res = nvx::deserialize_plain(is, (void *)this, sizeof *this); \
+		after_deserialization(); \
+		return res; \
+	}
+
+
+
+
+
+/************************ CONTAINERS ************************/
+// DECLARATIONS
+#define _NVX_SERIALIZE_CONTAINER_DECLARE_CORE(contname, bool_write) \
+	template< \
+		class Ostream, \
+		typename Meta, int Mode, \
+		typename...Other \
+	> \
+	int serialize( \
+		archive<Ostream, Meta, Mode> &os, \
+		contname<Other...> const *cont, \
+		bool_write \
+	)
+
+#define _NVX_DESERIALIZE_RESIZABLE_CONTAINER_DECLARE(contname) \
+	template< \
+		class Istream, \
+		typename Meta, int Mode, \
+		typename...Other \
+	> \
+	int deserialize( \
+		archive<Istream, Meta, Mode> &is, \
+		contname<Other...> *cont  \
+	)
+
+#define _NVX_DESERIALIZE_INSERTED_CONTAINER_DECLARE(contname) \
+	template< \
+		class Istream, \
+		typename Meta, int Mode, \
+		typename...Other \
+	> \
+	int deserialize( \
+		archive<Istream, Meta, Mode> &is, \
+		contname<Other...> *cont  \
+	) \
+
+
+
+// DEFINITIONS
+#define _NVX_SERIALIZE_CONTAINER_DEFINE(contname) \
+	_NVX_SERIALIZE_CONTAINER_DECLARE_CORE(contname, bool write) \
+	{ return nvx::serialize_container(os, cont, write); }
+
+#define _NVX_DESERIALIZE_RESIZABLE_CONTAINER_DEFINE(contname) \
+	_NVX_DESERIALIZE_RESIZABLE_CONTAINER_DECLARE(contname) \
+	{ return nvx::deserialize_resizable_container(is, cont); }
+
+#define _NVX_DESERIALIZE_INSERTED_CONTAINER_DEFINE(contname) \
+	_NVX_DESERIALIZE_INSERTED_CONTAINER_DECLARE(contname) \
+	{ return nvx::deserialize_inserted_container(is, cont); }
+
+
+
+// SERIALIZATION + DESERIALIZATION
+#define _NVX_SERIALIZABLE_RESIZABLE_CONTANER_DECLARE(contname) \
+	_NVX_SERIALIZE_CONTAINER_DECLARE_CORE(contname, bool write = true); \
+	_NVX_DESERIALIZE_RESIZABLE_CONTAINER_DECLARE(contname);
+
+#define _NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(contname) \
+	_NVX_SERIALIZE_CONTAINER_DECLARE_CORE(contname, bool write = true); \
+	_NVX_DESERIALIZE_INSERTED_CONTAINER_DECLARE(contname);
+
+
+#define _NVX_SERIALIZABLE_RESIZABLE_CONTANER_DEFINE(contname) \
+	_NVX_SERIALIZE_CONTAINER_DEFINE(contname); \
+	_NVX_DESERIALIZE_RESIZABLE_CONTAINER_DEFINE(contname);
+
+#define _NVX_SERIALIZABLE_INSERTED_CONTANER_DEFINE(contname) \
+	_NVX_SERIALIZE_CONTAINER_DEFINE(contname); \
+	_NVX_DESERIALIZE_INSERTED_CONTAINER_DEFINE(contname);
+
+
+
+
+
+
+
+
+
+
+/* DECLARATIONS */
+// main
+/*!
+ *
+ * \defgroup serialization_functions Функции сериализации
+ *
+ * Основные функции сериализации делятся на две группы:
+ * архивные и строковые; архивные (де)сериализуют объекты
+ * в архив, а строковые, соответственно, в строку.
+ *
+ * При использовании архивных функций первым первым аргументом
+ * всегда укызывается архив, в который (из которого)
+ * будет проводиться (де)сериализация; вторым аргументом
+ * всегда идёт указатель на сериализуемый объект (если
+ * необходимо сериализовать указатель, то передаётся указатель
+ * на указатель; если необходимо сериализовать массив,
+ * передаётся указатель на указатель на первый элемент массива),
+ * однако есть иключения:
+ * - если сериализуется статический массив (т.е. размер которого не
+ *   меняется во время выполнения программы), то передаётся
+ *   указатель на первый элемент массива (то есть сам массив)
+ *   (функция serialize_static)
+ * - если сериализуются плоские данные (serialize_plain), то
+ *   передаётся указатель на их первый байт
+ *
+ * Помимо одиночных объектов можно сериализовывать массивы, (TODO:
+ * c-strings) которые разделяются на два типа: динамические и
+ * статические. Отличие состоит в том, что при (де)сериализации
+ * динамического массива, помимо записи самих элементов, также
+ * добавляется размер массива; соответственно, пользователь при
+ * десериализации получает не только сами элементы, но и их
+ * количество — в отдельную (TODO: совместимую с int) переменную типа
+ * int; при (де)сериализации статического массива его размер всегда
+ * задаются извне пользователем. Есть ещё одно существенное отличие в
+ * этих функциях, а точнее в их синтаксисе: при сериализации
+ * динамического массива дополнительным аргументом передаётся
+ * указатель на int, из которого будет будет узнан размер массива при
+ * сериализации и, соответственно, куда будет помещён размер массива
+ * при десериализации. В случае статического массива передаётся сам
+ * размер, т.е. просто переменная типа int, а не указатель.
+ *
+ * В конце всех архивных функций сериализации находится
+ * необязательный аргумент `write`, который указывает,
+ * необходимо ли производить запись (по умолчанию
+ * запись, конечно, производится); если `write = false`,
+ * то объект не сериализуется и архив остаётся не тронутым,
+ * но возвращается количество байт, которое будет занимать
+ * записанный объект.
+ *
+ * Строковые функции могут использоваться с явным указанием
+ * объекта строки, в которую (из которой) должно происходить
+ * (де)сериализация, либо без оной. В первом случае в
+ * качестве первого аргумента выступает ссылка на строку,
+ * а уже затем идёт указатель на (де)сериализуемый объект и
+ * остальные аргументы; в самом конце всегда есть параметр
+ * режима архивации (ArchiveMode); во втором случае — то же
+ * самое, но из начала убирается ссылка на строку
+ *
+ * \warning При сериализации std::shared_ptr передаётся
+ * указатель на него, а не он сам
+ */
+
+
+/*!
+ * \defgroup archive_serialization Архивные функции сериализации
+ * \ingroup serialization_functions
+ *
+ * (Де)сериализуют единичные объекты, а также массивы или плоские
+ * данные в архив.
+ *
+ * @{
+ */
+
+/// Архивная функция сериализации единичного объекта
+/*!
+ * Сериализует единичный объект в архив.
+ *
+ * \param os — архив, в который производится сериализация
+ * \param value — указатель на сериализуемый объект
+ * \param write — указание, действительно ли производить сериализацию
+ *        или только подсчитать требуемое для оной число байт
+ *
+ * \return Число байт, которое было записано (или требуемое для этого)
+ */
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize(archive<Ostream, Meta, Mode> &os, T const *value, bool write = true);
+
+/// Архивная функция десериализации единичного объекта
+/*!
+ * Десериализует единичный объект из архива.
+ *
+ * \param os — архив, из которого производится десериализация
+ * \param value — указатель на десериализуемый объект
+ *
+ * \return Число считанных байт
+ */
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize(archive<Istream, Meta, Mode> &is, T *value);
+
+
+
+
+
+/*************** ARRAY AND PLAIN SERIALIZATION **************/
+/// Архивная функция сериализации динамического массива
+/*!
+ * Сериализует динамический массив в архив.
+ *
+ * \param os — архив, в который производится сериализация
+ * \param value — указатель на указатель на первый элемент
+ *        сериализуемого массива
+ * \param size — указатель на переменную, содержащую размер массива
+ * \param write — указание, действительно ли производить сериализацию
+ *        или только подсчитать требуемое для оной число байт
+ *
+ * \return Число байт, которое было записано (или требуемое для этого)
+ */
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize_array(
+	archive<Ostream, Meta, Mode> &os,
+	T const * const *value,
+	int const *size,
+	bool write = true
+);
+
+/// Архивная функция десериализации динамического массива
+/*!
+ * Десериализует динамический массив в архив.
+ *
+ * \param os — архив, в который производится сериализация
+ * \param value — указатель на указатель на первый элемент
+ *        сериализуемого массива
+ * \param size — указатель на переменную, содержащую размер массива
+ * \param write — указание, действительно ли производить сериализацию
+ *        или только подсчитать требуемое для оной число байт
+ *
+ * \return Число байт, которое было записано (или требуемое для этого)
+ */
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize_array(
+	archive<Istream, Meta, Mode> &is,
+	T **value,
+	int *size
+);
+
+/* @} */
+
+
+
+// static array
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize_static(
+	archive<Ostream, Meta, Mode> &os,
+	T const *value,
+	int size,
+	bool write = true
+);
+
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize_static(
+	archive<Istream, Meta, Mode> &is,
+	T *value,
+	int size
+);
+
+
+
+// plain
+template<class Ostream, typename Meta, int Mode>
+int serialize_plain(
+	archive<Ostream, Meta, Mode> &os,
+	void const *obj,
+	int size,
+	bool write = true
+);
+
+template<class Istream, typename Meta, int Mode>
+int deserialize_plain(
+	archive<Istream, Meta, Mode> &is,
+	void *obj,
+	int size
+);
+
+
+
+
+
+/****************** SERIALIZATION TO STRING *****************/
+/*!
+ * \defgroup string_serialization Строковые функции
+ * \ingroup serialization_functions
+ *
+ * Функции, которые не требуют архива, чтобы (де)сериализовать
+ * объект; (де)сериализация происходит в(из) строки
+ *
+ * @{
+ */
+
+/// Основная функция сериализации для одиночных объектов
+/// с явным указанием строки
+/*!
+ * Сериализация объекта value происходит в строку src,
+ * прежнее содержимое которой заменяется (ёмкость строки
+ * при этом сохраняется); дополнительно можно указать
+ * режим архива. Возвращает число сериализованных байт.
+ */
+template<typename T>
+int serialize(
+	std::string &src,
+	T const *value,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/// Сериализация одиночного объекта в конец строки
+/*!
+ * То же, что serialize(src, value, mode), но данные
+ * дописываются к текущему содержимому строки src
+ */
+template<typename T>
+int serialize_append(
+	std::string &src,
+	T const *value,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/// Основная функция сериализации для одиночных объектов
+/// без указания строки
+/*!
+ * Сериализация объекта value происходит в строку, а
+ * затем возвращается; дополнительно можно указать режим
+ * архива
+ */
+template<typename T>
+std::string serialize(
+	T const *value,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/// Основная функция (де)сериализации для одиночных объектов
+/// с явным указанием строки
+/*!
+ * Десериализация объекта value происходит из строки src;
+ * дополнительно можно указать режим архива. Возвращает
+ * число десериализованных байт.
+ */
+template<typename T>
+int deserialize(
+	std::string const &src,
+	T *value,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/// Основная функция (де)сериализации для одиночных объектов
+/// с явным указанием строки (перегрузка для rvalue)
+/*!
+ * Десериализация объекта value происходит из строки src;
+ * дополнительно можно указать режим архива. Возвращает
+ * число десериализованных байт.
+ */
+template<typename T>
+int deserialize(
+	std::string &&src,
+	T *value,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/// Основная функция десериализации для одиночных объектов
+/// из области памяти
+/*!
+ * Десериализация объекта value происходит непосредственно
+ * из size байт, начиная с data, без копирования; дополнительно
+ * можно указать режим архива. Возвращает число десериализованных
+ * байт (0, если данных не хватило).
+ */
+template<typename T>
+int deserialize(
+	char const *data,
+	size_t size,
+	T *value,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+
+
+// to string dynamic array
+/// Функция сериализации динамического массива в строку
+/// с явным указанием строки
+/*!
+ * Сериализует динамический массив в строку.
+ *
+ * \param src — строка, куда производится сериализация
+ * \param value — указатель на указатель на первый элемент массива
+ * \param size — указатель на переменную, хранящую размер массива
+ * \param mode — режим архива (см. ArchiveMode)
+ *
+ * \return Число сериализованных байт
+ */
+template<typename T>
+int serialize_array(
+	std::string &src,
+	T const * const *value,
+	int const *size,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/// Функция сериализации динамического массива в строку
+/// без явного указание строки
+/*!
+ * Сериализует динамический массив в строку.
+ *
+ * \param value — указатель на указатель на первый элемент массива
+ * \param size — указатель на переменную, хранящую размер массива
+ * \param mode — режим архива (см. ArchiveMode)
+ *
+ * \return Строку, в которую произвелась сериализация массива
+ */
+template<typename T>
+std::string serialize_array(
+	T const * const *value,
+	int const *size,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+
+/// Функция десериализации динамического массива из строки
+/*!
+ * Десериализует динамический массив из строки.
+ *
+ * \param src — строка, из которой производится сериализация
+ * \param value — указатель на указатель на первый элемент массива
+ * \param size — указатель на переменную, хранящую размер массива
+ * \param mode — режим архива (см. ArchiveMode)
+ *
+ * \return Число десериализованных байт
+ */
+template<typename T>
+int deserialize_array(
+	std::string const &src,
+	T **value,
+	int *size,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/// Функция десериализации динамического массива из строки
+/// (перегрузка для rvalue)
+/*!
+ * Десериализует динамический массив из строки.
+ *
+ * \param src — строка, из которой производится сериализация
+ * \param value — указатель на указатель на первый элемент массива
+ * \param size — указатель на переменную, хранящую размер массива
+ * \param mode — режим архива (см. ArchiveMode)
+ *
+ * \return Число десериализованных байт
+ */
+template<typename T>
+int deserialize_array(
+	std::string &&src,
+	T **value,
+	int *size,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+
+// to string static array
+/// Функция сериализации статического массива в строку
+/// с явным указанием строки
+/*!
+ * Сериализует статический массив в строку.
+ *
+ * \param src — строка, куда производится сериализация
+ * \param value — указатель на указатель на первый элемент массива
+ * \param size — размер статического массива
+ * \param mode — режим архива (см. ArchiveMode)
+ *
+ * \return Число сериализованных байт
+ */
+template<typename T>
+int serialize_static(
+	std::string &src,
+	T const *value,
+	int size,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/// Функция сериализации статического массива в строку
+/// без явного указание строки
+/*!
+ * Сериализует статический массив в строку.
+ *
+ * \param value — указатель на указатель на первый элемент массива
+ * \param size — размер статического массива
+ * \param mode — режим архива (см. ArchiveMode)
+ *
+ * \return Строку, в которую произвелась сериализация массива
+ */
+template<typename T>
+std::string serialize_static(
+	T const *value,
+	int size,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+
+/// Функция десериализации статического массива из строки
+/*!
+ * Десериализует статический массив из строки.
+ *
+ * \param src — строка, из которой производится сериализация
+ * \param value — указатель на указатель на первый элемент массива
+ * \param size — размер массива
+ * \param mode — режим архива (см. ArchiveMode)
+ *
+ * \return Число десериализованных байт
+ */
+template<typename T>
+int deserialize_static(
+	std::string const &src,
+	T *value,
+	int size,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/// Функция десериализации статического массива из строки
+/// (перегрузка для rvalue)
+/*!
+ * Десериализует статический массив из строки.
+ *
+ * \param src — строка, из которой производится сериализация
+ * \param value — указатель на указатель на первый элемент массива
+ * \param size — размер массива
+ * \param mode — режим архива (см. ArchiveMode)
+ *
+ * \return Число десериализованных байт
+ */
+template<typename T>
+int deserialize_static(
+	std::string &&src,
+	T *value,
+	int size,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/* @} */
+
+
+
+
+
+/********************* SERIALIZED SIZE ********************/
+/*!
+ * \defgroup serialized_size Размер сериализованных объектов
+ * \ingroup serialization_functions
+ *
+ * Функции, вычисляющие число байт, которое займёт объект
+ * после сериализации, не обращаясь ни к какому потоку
+ *
+ * @{
+ */
+
+/// Размер сериализованного объекта типа T
+/*!
+ * Вычисляется на этапе компиляции; доступна только для
+ * типов постоянного размера (см. is_fixed_size)
+ */
+template<typename T>
+constexpr int serialized_size();
+
+/// Размер сериализованного объекта value
+/*!
+ * Для типов постоянного размера совпадает с serialized_size<T>();
+ * для остальных объект обходится с архивом над size_ostream,
+ * поэтому учитываются все режимы архива (в том числе
+ * determine_pointers_mode, для которого счёт с `write = false`
+ * без Лиры невозможен)
+ *
+ * \param value — указатель на объект
+ * \param mode — режим архива (см. ArchiveMode)
+ *
+ * \return Число байт, которое займёт сериализованный объект
+ */
+template<typename T>
+int serialized_size(
+	T const *value,
+	int mode = ArchiveMode::determine_shared_mode
+);
+
+/* @} */
+
+
+
+
+
+// final
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_final(
+	archive<Ostream, Meta, Mode> &os,
+	T const *value,
+	bool write = true
+);
+
+template<class Ostream, typename Meta, int Mode, typename T>
+int _deserialize_final(
+	archive<Ostream, Meta, Mode> &os,
+	T *value
+);
+
+
+
+// modes
+/// Установлен ли в архиве a флаг режима flag (см. ArchiveMode)
+template<class Stream, typename Meta, int Mode>
+bool _has_mode(archive<Stream, Meta, Mode> const &a, int flag);
+
+/// Нужно ли в режиме архива a разворачивать байты чисел типа T
+/// (little_endian_mode или big_endian_mode не совпадает с машиной)
+template<typename T, class Stream, typename Meta, int Mode>
+bool _swap_enabled(archive<Stream, Meta, Mode> const &a);
+
+
+
+// varint
+/// Запись беззнакового целого в формате varint
+template<class Ostream, typename Meta, int Mode, typename U>
+int _serialize_varint(
+	archive<Ostream, Meta, Mode> &os,
+	U value,
+	bool write
+);
+
+/// Чтение беззнакового целого в формате varint
+template<class Istream, typename Meta, int Mode, typename U>
+int _deserialize_varint(
+	archive<Istream, Meta, Mode> &is,
+	U *value
+);
+
+
+
+// ranges
+/// Можно ли в режиме архива a записывать массивы T одним блоком
+template<typename T, class Stream, typename Meta, int Mode>
+bool _bulk_enabled(archive<Stream, Meta, Mode> const &a);
+
+/// Совпадает ли в режиме архива a размер сериализованного T
+/// с serialized_size<T>()
+template<typename T, class Stream, typename Meta, int Mode>
+bool _fixed_enabled(archive<Stream, Meta, Mode> const &a);
+
+/// Сериализация size подряд идущих в памяти элементов
+/*!
+ * Если элементы можно записать одним копированием памяти
+ * (см. is_bulk_serializable), то весь диапазон передаётся
+ * потоку за одно обращение; иначе элементы сериализуются
+ * по одному
+ */
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_range(
+	archive<Ostream, Meta, Mode> &os,
+	T const *value,
+	size_t size,
+	bool write
+);
+
+/// Десериализация size подряд идущих в памяти элементов
+template<class Istream, typename Meta, int Mode, typename T>
+int _deserialize_range(
+	archive<Istream, Meta, Mode> &is,
+	T *value,
+	size_t size
+);
+
+/// Получение n байт прямо из буфера потока без копирования
+/// (поток должен хранить данные в памяти, см. memory_istream)
+template<class Istream, typename Meta, int Mode>
+char const *_take(archive<Istream, Meta, Mode> &is, size_t n);
+
+/// Нужно ли в режиме архива a выравнивать блок элементов T
+template<typename T, class Stream, typename Meta, int Mode>
+bool _padding_enabled(archive<Stream, Meta, Mode> const &a);
+
+/// Запись нулевых байт до позиции, кратной align
+template<class Ostream, typename Meta, int Mode>
+int _serialize_padding(
+	archive<Ostream, Meta, Mode> &os,
+	size_t align,
+	bool write
+);
+
+/// Пропуск байт, записанных _serialize_padding
+template<class Istream, typename Meta, int Mode>
+int _deserialize_padding(
+	archive<Istream, Meta, Mode> &is,
+	size_t align
+);
+
+/// То же, что _serialize_range, но с выравниванием блока
+/// в режиме aligned_mode (так записываются vector и span)
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_aligned_range(
+	archive<Ostream, Meta, Mode> &os,
+	T const *value,
+	size_t size,
+	bool write
+);
+
+/// Десериализация, парная _serialize_aligned_range
+template<class Istream, typename Meta, int Mode, typename T>
+int _deserialize_aligned_range(
+	archive<Istream, Meta, Mode> &is,
+	T *value,
+	size_t size
+);
+
+
+
+// allocation
+/// Создание объекта, на который указывает десериализуемый
+/// указатель (в арене архива, если она подключена и
+/// inarena, и с ресурсом памяти архива, если он задан)
+template<typename T, class Stream, typename Meta, int Mode>
+T *_new_object(archive<Stream, Meta, Mode> &is, bool inarena = true);
+
+/// Создание объекта для десериализуемого shared_ptr
+template<typename T, class Stream, typename Meta, int Mode>
+std::shared_ptr<T> _new_shared(archive<Stream, Meta, Mode> &is);
+
+/// Объект T, сконструированный с аллокатором a, если T
+/// его поддерживает (для пар — оба элемента); иначе T()
+template<typename T, class Alloc>
+T _make_using_allocator(Alloc const &a);
+
+/// Создание десериализуемого динамического массива
+template<typename T, class Stream, typename Meta, int Mode>
+T *_new_array(archive<Stream, Meta, Mode> &is, size_t size);
+
+
+
+
+
+/****************** POINTERS SERIALIZATION ******************/
+/*!
+ * \defgroup pointers_serialization Сериализация указателей
+ * \ingroup serialization_functions
  *
- * \defgroup serialization_functions Функции сериализации
- *
- * Основные функции сериализации делятся на две группы:
- * архивные и строковые; архивные (де)сериализуют объекты
- * в архив, а строковые, соответственно, в строку.
- *
- * При использовании архивных функций первым первым аргументом
- * всегда укызывается архив, в который (из которого)
- * будет проводиться (де)сериализация; вторым аргументом
- * всегда идёт указатель на сериализуемый объект (если
- * необходимо сериализовать указатель, то передаётся указатель
- * на указатель; если необходимо сериализовать массив,
- * передаётся указатель на указатель на первый элемент массива),
- * однако есть иключения:
- * - если сериализуется статический массив (т.е. размер которого не
- *   меняется во время выполнения программы), то передаётся
- *   указатель на первый элемент массива (то есть сам массив)
- *   (функция serialize_static)
- * - если сериализуются плоские данные (serialize_plain), то
- *   передаётся указатель на их первый байт
+ * Эта группа содержит функции, отвечающие за сериализацию
+ * указателей, как обычных так и shared; работу этих
+ * функций контролирует режим архива ArchiveMode
  *
- * Помимо одиночных объектов можно сериализовывать массивы, (TODO:
- * c-strings) которые разделяются на два типа: динамические и
- * статические. Отличие состоит в том, что при (де)сериализации
- * динамического массива, помимо записи самих элементов, также
- * добавляется размер массива; соответственно, пользователь при
- * десериализации получает не только сами элементы, но и их
- * количество — в отдельную (TODO: совместимую с int) переменную типа
- * int; при (де)сериализации статического массива его размер всегда
- * задаются извне пользователем. Есть ещё одно существенное отличие в
- * этих функциях, а точнее в их синтаксисе: при сериализации
- * динамического массива дополнительным аргументом передаётся
- * указатель на int, из которого будет будет узнан размер массива при
- * сериализации и, соответственно, куда будет помещён размер массива
- * при десериализации. В случае статического массива передаётся сам
- * размер, т.е. просто переменная типа int, а не указатель.
+ * @{
+ */
+
+/// Вспомогательная функция для сериализации обычных указателей
+/*!
+ * Вспомогательная функция для сериализации,
+ * которая определяет, является ли obj
+ * указателем на указатель; эта перегрузка
+ * вызывается, если является; если включено
+ * разпознавание разделяемых обычных указателей
+ * (т.е. установлен флаг determine_pointers_mode),
+ * то функция ведёт себя особым образом
+ */
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_dispatcher(
+	archive<Ostream, Meta, Mode> &os,
+	T const *obj,
+	std::true_type,
+	bool write = true
+);
+
+/// Вспомогательная функция для сериализации обычных указателей
+/*!
+ * Вспомогательная функция для сериализации,
+ * которая определяет, является ли obj
+ * указателем на указатель; эта перегрузка
+ * вызывается, если не является
+ */
+template<class Ostream, typename Meta, int Mode, typename T>
+inline int _serialize_dispatcher(
+	archive<Ostream, Meta, Mode> &os,
+	T const *obj,
+	std::false_type,
+	bool write = true
+);
+
+
+/// Вспомогательная функция для десериализации обычных указателей
+/*!
+ * Вспомогательная функция для десериализации,
+ * которая определяет, является ли obj
+ * указателем на указатель; эта перегрузка
+ * вызывается, если является; если включено
+ * разпознавание разделяемых обычных указателей
+ * (т.е. установлен флаг determine_pointers_mode),
+ * то функция ведёт себя особым образом
+ */
+template<class Ostream, typename Meta, int Mode, typename T>
+int _deserialize_dispatcher(
+	archive<Ostream, Meta, Mode> &os,
+	T *obj,
+	std::true_type
+);
+
+/// Вспомогательная функция для десериализации обычных указателей
+/*!
+ * Вспомогательная функция для десериализации,
+ * которая определяет, является ли obj
+ * указателем на указатель; эта перегрузка
+ * вызывается, если не является
+ */
+template<class Ostream, typename Meta, int Mode, typename T>
+inline int _deserialize_dispatcher(
+	archive<Ostream, Meta, Mode> &os,
+	T *obj,
+	std::false_type
+);
+
+
+
+// pointees
+/// Сериализация объекта, на который указывает указатель
+/*!
+ * В режиме iterative_mode объект, встреченный во время
+ * обхода, откладывается в очередь архива; первый объект
+ * запускает обработку очереди (см. _run_tasks)
+ */
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_pointee(
+	archive<Ostream, Meta, Mode> &os,
+	T const *obj,
+	bool write
+);
+
+/// Десериализация объекта, на который указывает указатель
+template<class Istream, typename Meta, int Mode, typename T>
+int _deserialize_pointee(
+	archive<Istream, Meta, Mode> &is,
+	T *obj
+);
+
+/// Обработка очереди отложенных объектов архива
+template<class Stream, typename Meta, int Mode>
+int _run_tasks(archive<Stream, Meta, Mode> &a);
+
+/// Идёт ли обход очереди отложенных объектов архива a
+template<class Stream, typename Meta, int Mode>
+bool _traversing(archive<Stream, Meta, Mode> const &a);
+
+/// Откладывание after_deserialization объекта obj
+/*!
+ * Во время обхода очереди в режиме iterative_mode объекты,
+ * на которые указывают поля obj, ещё не прочитаны, поэтому
+ * собственный after_deserialization вызывается в конце обхода
+ * (см. _run_tasks). Возвращает false, если вызвать его нужно
+ * сразу
+ */
+template<class Istream, typename Meta, int Mode, typename T>
+bool _defer_after_deserialization(archive<Istream, Meta, Mode> &is, T *obj);
+
+
+
+// shared pointers
+/// Вспомогательная функция для сериализации std::shared_ptr
+/*!
+ * Вспомогательная функция для сериализации,
+ * если включено разпознавание разделяемых
+ * shared_pointer (т.е. установлен флаг
+ * determine_shared_mode), то функция ведёт
+ * себя особым образом
+ */
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	std::shared_ptr<T> const *obj,
+	bool write = true
+);
+
+/// Вспомогательная функция для десериализации std::shared_ptr
+/*!
+ * Вспомогательная функция для десериализации,
+ * если включено разпознавание разделяемых
+ * shared_pointer (т.е. установлен флаг
+ * determine_shared_mode), то функция ведёт
+ * себя особым образом
+ */
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	std::shared_ptr<T> *obj
+);
+
+
+
+// weak pointers
+/// Вспомогательная функция для сериализации std::weak_ptr
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	std::weak_ptr<T> const *obj,
+	bool write = true
+);
+
+/// Вспомогательная функция для десериализации std::weak_ptr
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	std::weak_ptr<T> *obj
+);
+
+
+
+// unique pointers
+/// Вспомогательная функция для сериализации std::unique_ptr
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	std::unique_ptr<T> const *obj,
+	bool write = true
+);
+
+/// Вспомогательная функция для десериализации std::unique_ptr
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	std::unique_ptr<T> *obj
+);
+
+/*! @} */
+
+
+
+
+
+/************************ STD-STRUCTS ***********************/
+/* STD-STRUCTS */
+/*!
+ * \defgroup std_serialization Стандартные контейнеры и структуры
+ * \ingroup serialization_functions
  *
- * В конце всех архивных функций сериализации находится
- * необязательный аргумент `write`, который указывает,
- * необходимо ли производить запись (по умолчанию
- * запись, конечно, производится); если `write = false`,
- * то объект не сериализуется и архив остаётся не тронутым,
- * но возвращается количество байт, которое будет занимать
- * записанный объект.
+ * Эти функции предназначены для сериализации стандартных
+ * контейнеров и структур, а именно:
+ *
+ * - `pair`
+ * - `vector`
+ * - `list`
+ * - `set`
+ * - `multiset`
+ * - `unordered_set`
+ * - `unordered_multiset`
+ * - `map`
+ * - `multimap`
+ * - `unordered_map`
+ * - `unordered_multimap`
+ *
+ * Каждая функция (де)сериализации устроена по единому образцу:
+ *
+ * \param os — архив, с помощью которого будет производится
+ * (де)сериализация
+ *
+ * \param obj — объект, который необходимо (де)сериализовать
+ *
+ * \param [write] — аргумент только для функций сериализации;
+ * говорит о том, действительно ли нужно сеарилизовать объект
+ * или же только возвратить необходимый для сериализации
+ * размер
+ * @{
+ */
+
+/// Сериализация пары значений std::pair
+template<class Ostream, typename Meta, int Mode, typename T, typename U>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	std::pair<T, U> const *p,
+	bool write = true
+);
+
+/// Десериализация пары значений std::pair
+template<class Istream, typename Meta, int Mode, typename T, typename U>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	std::pair<T, U> *p
+);
+
+
+
+// views
+/// Сериализация std::basic_string_view (так же, как строки)
+template<class Ostream, typename Meta, int Mode, typename C, typename Traits>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	std::basic_string_view<C, Traits> const *view,
+	bool write = true
+);
+
+/// Десериализация строки без копирования
+/*!
+ * Представление указывает прямо в данные потока, поэтому
+ * поток должен хранить данные в памяти (см. memory_istream)
+ */
+template<class Istream, typename Meta, int Mode, typename C, typename Traits>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	std::basic_string_view<C, Traits> *view
+);
+
+/// Сериализация span (так же, как vector)
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	span<T> const *view,
+	bool write = true
+);
+
+/// Десериализация массива без копирования
+/*!
+ * Поток должен хранить данные в памяти (см. memory_istream);
+ * если элементы в буфере оказались не выровнены (массив
+ * записан без режима aligned_mode), бросается исключение
+ */
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	span<T> *view
+);
+
+
+
+
+
+/* CONTAINERS */
+
+/// Вспомогательная функция для сериализации контейнеров
+/*!
+ * Функция принимает указатель на контейнер, который
+ * должен предоставлять следующие методы:
+ *
+ * - size() -> int32_t — размер контейнера; возвращаемое значение
+ *   должно быть преобразуемо к int32_t
+ * - begin() — доступ к итератору, установленному на начало
+ * - end() — доступ к итератору, установленному на конец
  *
- * Строковые функции могут использоваться с явным указанием
- * объекта строки, в которую (из которой) должно происходить
- * (де)сериализация, либо без оной. В первом случае в
- * качестве первого аргумента выступает ссылка на строку,
- * а уже затем идёт указатель на (де)сериализуемый объект и
- * остальные аргументы; в самом конце всегда есть параметр
- * режима архивации (ArchiveMode); во втором случае — то же
- * самое, но из начала убирается ссылка на строку
+ * Соответственно, итераторы, получаемые с помощью методов
+ * begin и end, должны предоставлять следующие возможности:
  *
- * \warning При сериализации std::shared_ptr передаётся
- * указатель на него, а не он сам
+ * - T &operator*() — получение элемента
+ * - operator++() — переход на следующих элемент
+ * - bool operator!=(Iterator rhs) — сравнение с другим итератором
  */
+template<class Ostream, typename Meta, int Mode, class Container>
+int serialize_container(
+	archive<Ostream, Meta, Mode> &os,
+	Container const *cont,
+	bool write = true
+);
 
 
+/// Вспомогательная функция для десериализации контейнеров,
+/// способных изменять размер с помощью функции resize()
 /*!
- * \defgroup archive_serialization Архивные функции сериализации
- * \ingroup serialization_functions
+ * Контейнер должен реализовывать следующие функции:
  *
- * (Де)сериализуют единичные объекты, а также массивы или плоские
- * данные в архив.
+ * - resize(int32_t) — задание размера контейнера
+ * - begin() — доступ к итератору, установленному на начало
+ * - end() — доступ к итератору, установленному на конец
  *
- * @{
+ * Соответственно, итераторы, получаемые с помощью методов
+ * begin и end, должны предоставлять следующие возможности:
+ *
+ * - T &operator*() — получение элемента
+ * - operator++() — переход на следующих элемент
+ * - bool operator!=(Iterator rhs) — сравнение с другим итератором
  */
+template<class Istream, typename Meta, int Mode, class ResizableContainer>
+int deserialize_resizable_container(
+	archive<Istream, Meta, Mode> &is,
+	ResizableContainer *cont
+);
 
-/// Архивная функция сериализации единичного объекта
+/// Вспомогательная функция для десериализации контейнеров,
+/// хранящих элементы в непрерывной области памяти
 /*!
- * Сериализует единичный объект в архив.
- *
- * \param os — архив, в который производится сериализация
- * \param value — указатель на сериализуемый объект
- * \param write — указание, действительно ли производить сериализацию
- *        или только подсчитать требуемое для оной число байт
- *
- * \return Число байт, которое было записано (или требуемое для этого)
+ * Размер size уже считан; элементы, которые можно скопировать
+ * одним блоком, считываются сразу все, а если поток хранит
+ * данные в памяти (memory_istream), то контейнер заполняется
+ * прямо из неё
  */
-template<class Ostream, typename Meta, typename T>
-int serialize(archive<Ostream, Meta> &os, T const *value, bool write = true);
+template<class Istream, typename Meta, int Mode, class ContiguousContainer>
+int _deserialize_contiguous(
+	archive<Istream, Meta, Mode> &is,
+	ContiguousContainer *cont,
+	int32_t size
+);
+
+
+
+/// Вспомогательная функция для десериализации контейнеров,
+/// в которые необходимо вставлять элементы
 
-/// Архивная функция десериализации единичного объекта
 /*!
- * Десериализует единичный объект из архива.
+ * Контейнер должен реализовывать следующие функции:
  *
- * \param os — архив, из которого производится десериализация
- * \param value — указатель на десериализуемый объект
+ * - clear() — удаление всех элементов контейнера
+ * - insert(T) — добавление элемента в контейнер
+ * - begin() — доступ к итератору, установленному на начало
+ * - end() — доступ к итератору, установленному на конец
  *
- * \return Число считанных байт
+ * Соответственно, итераторы, получаемые с помощью методов
+ * begin и end, должны предоставлять следующие возможности:
+ *
+ * - T &operator*() — получение элемента
+ * - operator++() — переход на следующих элемент
+ * - bool operator!=(Iterator rhs) — сравнение с другим итератором
  */
-template<class Istream, typename Meta, typename T>
-int deserialize(archive<Istream, Meta> &is, T *value);
 
+template<
+	typename T,
+	class Istream,
+	typename Meta, int Mode,
+	class Cont
+>
+int deserialize_inserted_container(
+	archive<Istream, Meta, Mode> &is,
+	Cont *cont
+);
 
 
 
+/// Вставка в контейнер очередного десериализованного элемента
+/*!
+ * В упорядоченные контейнеры элементы вставляются с подсказкой
+ * end() (они приходят в порядке возрастания), поэтому такие
+ * контейнеры должны также реализовывать insert(iterator, T);
+ * в непрерывные (vector) элементы дописываются в конец
+ */
+template<class Cont, typename T>
+void _insert_next(Cont *cont, T &&obj);
 
-/*************** ARRAY AND PLAIN SERIALIZATION **************/
-/// Архивная функция сериализации динамического массива
+/// Чтение size элементов и вставка их в контейнер
 /*!
- * Сериализует динамический массив в архив.
- *
- * \param os — архив, в который производится сериализация
- * \param value — указатель на указатель на первый элемент
- *        сериализуемого массива
- * \param size — указатель на переменную, содержащую размер массива
- * \param write — указание, действительно ли производить сериализацию
- *        или только подсчитать требуемое для оной число байт
- *
- * \return Число байт, которое было записано (или требуемое для этого)
+ * Во время обхода очереди в режиме iterative_mode от ещё не
+ * прочитанных объектов, на которые указывают элементы, может
+ * зависеть их сравнение или хеш, поэтому элементы читаются в
+ * отдельный буфер и вставляются в конце обхода (см. _run_tasks)
  */
-template<class Ostream, typename Meta, typename T>
-int serialize_array(
-	archive<Ostream, Meta> &os,
-	T const * const *value,
-	int const *size,
-	bool write = true
+template<class Istream, typename Meta, int Mode, class Cont>
+int _deserialize_inserted_elements(
+	archive<Istream, Meta, Mode> &is,
+	Cont *cont,
+	int32_t size
 );
 
-/// Архивная функция десериализации динамического массива
+
+
+/// Вспомогательная функция для сериализации контейнеров
+/// в режиме chunked_mode
 /*!
- * Десериализует динамический массив в архив.
- *
- * \param os — архив, в который производится сериализация
- * \param value — указатель на указатель на первый элемент
- *        сериализуемого массива
- * \param size — указатель на переменную, содержащую размер массива
- * \param write — указание, действительно ли производить сериализацию
- *        или только подсчитать требуемое для оной число байт
- *
- * \return Число байт, которое было записано (или требуемое для этого)
+ * Элементы записываются частями по CHUNK_ELEMENTS, за
+ * последней частью следует нулевой размер
  */
-template<class Istream, typename Meta, typename T>
-int deserialize_array(
-	archive<Istream, Meta> &is,
-	T **value,
-	int *size
+template<class Ostream, typename Meta, int Mode, class Container>
+int _serialize_chunked_container(
+	archive<Ostream, Meta, Mode> &os,
+	Container const *cont,
+	bool write
 );
 
-/* @} */
+/// Чтение частей контейнера, записанного в режиме chunked_mode
+/*!
+ * Для каждой части вызывается read(size), которая должна
+ * считать size элементов и вернуть число считанных байт;
+ * часть больше CHUNK_ELEMENTS считается повреждённой
+ */
+template<class Istream, typename Meta, int Mode, class F>
+int _deserialize_chunks(
+	archive<Istream, Meta, Mode> &is,
+	F const &read
+);
 
 
 
-// static array
-template<class Ostream, typename Meta, typename T>
-int serialize_static(
-	archive<Ostream, Meta> &os,
-	T const *value,
-	int size,
-	bool write = true
+/// Запись заголовка контейнера с таблицей смещений частей
+/*!
+ * Вместо размера записывается INDEXED_MARK, затем размер
+ * контейнера size, число элементов в части chunk и длины
+ * частей в байтах; за заголовком части идут подряд, так что
+ * их можно разбирать независимо
+ */
+template<class Ostream, typename Meta, int Mode>
+int _serialize_index(
+	archive<Ostream, Meta, Mode> &os,
+	int32_t size,
+	int32_t chunk,
+	std::vector<ullong> const &lengths
 );
 
-template<class Istream, typename Meta, typename T>
-int deserialize_static(
-	archive<Istream, Meta> &is,
-	T *value,
-	int size
+/// Чтение заголовка, записанного _serialize_index
+/// (INDEXED_MARK уже считан)
+template<class Istream, typename Meta, int Mode>
+int _deserialize_index(
+	archive<Istream, Meta, Mode> &is,
+	int32_t *size,
+	int32_t *chunk,
+	std::vector<ullong> *lengths
 );
 
 
 
-// plain
-template<class Ostream, typename Meta>
-int serialize_plain(
-	archive<Ostream, Meta> &os,
-	void const *obj,
-	int size,
+/// Вспомогательная функция для сериализации упорядоченных
+/// контейнеров с целочисленными ключами в режиме delta_mode
+/*!
+ * Размер контейнера уже записан; ключи записываются в формате
+ * varint разностями с предыдущим ключом, за каждым ключом
+ * (для map и multimap) следует значение
+ */
+template<class Ostream, typename Meta, int Mode, class Container>
+int _serialize_delta_container(
+	archive<Ostream, Meta, Mode> &os,
+	Container const *cont,
 	bool write = true
 );
 
-template<class Istream, typename Meta>
-int deserialize_plain(
-	archive<Istream, Meta> &is,
-	void *obj,
-	int size
+/// Вспомогательная функция для десериализации упорядоченных
+/// контейнеров с целочисленными ключами в режиме delta_mode
+template<class Istream, typename Meta, int Mode, class Container>
+int _deserialize_delta_container(
+	archive<Istream, Meta, Mode> &is,
+	Container *cont,
+	int32_t size
 );
 
 
 
 
 
-/****************** SERIALIZATION TO STRING *****************/
-/*!
- * \defgroup string_serialization Строковые функции
- * \ingroup serialization_functions
- *
- * Функции, которые не требуют архива, чтобы (де)сериализовать
- * объект; (де)сериализация происходит в(из) строки
- *
- * @{
- */
+_NVX_SERIALIZABLE_RESIZABLE_CONTANER_DECLARE(std::basic_string);
 
-/// Основная функция сериализации для одиночных объектов
-/// с явным указанием строки
-/*!
- * Сериализация объекта value происходит в строку src
- * (TODO: перезапись и добавление); дополнительно можно
- * указать режим архива. Возвращает число сериализованных
- * байт.
- */
-template<typename T>
+_NVX_SERIALIZABLE_RESIZABLE_CONTANER_DECLARE(std::vector);
+_NVX_SERIALIZABLE_RESIZABLE_CONTANER_DECLARE(std::list);
+
+_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::set);
+_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::map);
+_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::multiset);
+_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::multimap);
+
+_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::unordered_set);
+_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::unordered_map);
+_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::unordered_multiset);
+_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::unordered_multimap);
+
+
+
+
+
+
+
+
+
+
+/* DEFINITIONS */
+// main
+template<class Ostream, typename Meta, int Mode, typename T>
 int serialize(
-	std::string &src,
+	archive<Ostream, Meta, Mode> &os,
 	T const *value,
-	int mode = ArchiveMode::determine_shared_mode
-);
+	bool write
+)
+{
+	if constexpr(is_fixed_size<T>::value)
+	{
+		if(!write && _fixed_enabled<T>(os))
+			return _fixed_size<T>::value;
+	}
 
-/// Основная функция сериализации для одиночных объектов
-/// без указания строки
+	return _serialize_dispatcher(
+		os, value,
+		typename std::is_pointer<T>::type(),
+		write
+	);
+}
+
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	T *value
+)
+{
+	return _deserialize_dispatcher(
+		is, value,
+		typename std::is_pointer<T>::type()
+	);
+}
+
+
+
+
+
+/****************** SERIALIZATION TO STRING *****************/
 /*!
- * Сериализация объекта value происходит в строку, а
- * затем возвращается (TODO: перезапись и добавление);
- * дополнительно можно указать режим архива
+ * Дописывает в конец строки dst то, что функция fn
+ * сериализует в переданный ей архив. Если указатели не
+ * отслеживаются, fn сначала вызывается без записи для архива
+ * над size_ostream, чтобы выделить память под результат один
+ * раз; затем — для архива над самой строкой
  */
+template<typename F>
+int _serialize_to_string(std::string &dst, int mode, F const &fn)
+{
+	/*
+	 * Без отслеживания указателей размер считается без записи
+	 * (write = false), обычно не обходя элементы; иначе подсчёт
+	 * без Лиры означал бы второй полный обход с регистрацией
+	 * указателей, и строка просто растёт по мере записи
+	 */
+	if( !(mode & (determine_pointers_mode | determine_shared_mode)) )
+	{
+		size_ostream cnt;
+		archive<size_ostream> counter(&cnt, mode);
+		dst.reserve( dst.size() + fn(counter, false) );
+	}
+
+	buffer_ostream buf(&dst);
+	archive<buffer_ostream> arch(&buf, mode);
+	return fn(arch, true);
+}
+
 template<typename T>
-std::string serialize(
-	T const *value,
-	int mode = ArchiveMode::determine_shared_mode
-);
+int serialize(std::string &src, T const *value, int mode)
+{
+	src.clear();
+	return serialize_append(src, value, mode);
+}
 
-/// Основная функция (де)сериализации для одиночных объектов
-/// с явным указанием строки
-/*!
- * Десериализация объекта value происходит из строки src
- * (TODO: перезапись и добавление); дополнительно можно
- * указать режим архива. Возвращает число десериализованных
- * байт.
- */
 template<typename T>
-int deserialize(
-	std::string const &src,
-	T *value,
-	int mode = ArchiveMode::determine_shared_mode
-);
+int serialize_append(std::string &src, T const *value, int mode)
+{
+	return _serialize_to_string(src, mode, [value](auto &arch, bool write) {
+		return serialize(arch, value, write);
+	});
+}
+
+template<typename T>
+std::string serialize(T const *value, int mode)
+{
+	std::string res;
+	serialize_append(res, value, mode);
+	return res;
+}
+
+template<typename T>
+int deserialize(std::string const &src, T *value, int mode)
+{
+	memory_istream ms(src);
+	archive<decltype(ms)> arch(&ms, mode);
+
+	return deserialize(arch, value);
+}
+
+template<typename T>
+int deserialize( std::string &&src, T *value, int mode )
+{
+	memory_istream ms(src);
+	archive<decltype(ms)> arch(&ms, mode);
+
+	return deserialize(arch, value);
+}
 
-/// Основная функция (де)сериализации для одиночных объектов
-/// с явным указанием строки (перегрузка для rvalue)
-/*!
- * Десериализация объекта value происходит из строки src
- * (TODO: перезапись и добавление); дополнительно можно
- * указать режим архива. Возвращает число десериализованных
- * байт.
- */
 template<typename T>
-int deserialize(
-	std::string &&src,
-	T *value,
-	int mode = ArchiveMode::determine_shared_mode
-);
+int deserialize(char const *data, size_t size, T *value, int mode)
+{
+	memory_istream ms(data, size);
+	archive<decltype(ms)> arch(&ms, mode);
+
+	int res = deserialize(arch, value);
+	return ms ? res : 0;
+}
 
 
 
 // to string dynamic array
-/// Функция сериализации динамического массива в строку
-/// с явным указанием строки
-/*!
- * Сериализует динамический массив в строку.
- *
- * \param src — строка, куда производится сериализация
- * \param value — указатель на указатель на первый элемент массива
- * \param size — указатель на переменную, хранящую размер массива
- * \param mode — режим архива (см. ArchiveMode)
- *
- * \return Число сериализованных байт
- */
 template<typename T>
 int serialize_array(
 	std::string &src,
 	T const * const *value,
 	int const *size,
-	int mode = ArchiveMode::determine_shared_mode
-);
+	int mode
+)
+{
+	src.clear();
+	return _serialize_to_string(src, mode, [value, size](auto &arch, bool write) {
+		return serialize_array(arch, value, size, write);
+	});
+}
 
-/// Функция сериализации динамического массива в строку
-/// без явного указание строки
-/*!
- * Сериализует динамический массив в строку.
- *
- * \param value — указатель на указатель на первый элемент массива
- * \param size — указатель на переменную, хранящую размер массива
- * \param mode — режим архива (см. ArchiveMode)
- *
- * \return Строку, в которую произвелась сериализация массива
- */
 template<typename T>
 std::string serialize_array(
 	T const * const *value,
 	int const *size,
-	int mode = ArchiveMode::determine_shared_mode
-);
+	int mode
+)
+{
+	std::string res;
+	serialize_array(res, value, size, mode);
+	return res;
+}
 
 
-/// Функция десериализации динамического массива из строки
-/*!
- * Десериализует динамический массив из строки.
- *
- * \param src — строка, из которой производится сериализация
- * \param value — указатель на указатель на первый элемент массива
- * \param size — указатель на переменную, хранящую размер массива
- * \param mode — режим архива (см. ArchiveMode)
- *
- * \return Число десериализованных байт
- */
 template<typename T>
 int deserialize_array(
 	std::string const &src,
 	T **value,
 	int *size,
-	int mode = ArchiveMode::determine_shared_mode
-);
+	int mode
+)
+{
+	memory_istream ms(src);
+	archive<decltype(ms)> arch(&ms, mode);
+
+	return deserialize_array(arch, value, size);
+}
 
-/// Функция десериализации динамического массива из строки
-/// (перегрузка для rvalue)
-/*!
- * Десериализует динамический массив из строки.
- *
- * \param src — строка, из которой производится сериализация
- * \param value — указатель на указатель на первый элемент массива
- * \param size — указатель на переменную, хранящую размер массива
- * \param mode — режим архива (см. ArchiveMode)
- *
- * \return Число десериализованных байт
- */
 template<typename T>
 int deserialize_array(
 	std::string &&src,
 	T **value,
 	int *size,
-	int mode = ArchiveMode::determine_shared_mode
-);
+	int mode
+)
+{
+	memory_istream ms(src);
+	archive<decltype(ms)> arch(&ms, mode);
+
+	return deserialize_array(arch, value, size);
+}
+
 
 
 // to string static array
-/// Функция сериализации статического массива в строку
-/// с явным указанием строки
-/*!
- * Сериализует статический массив в строку.
- *
- * \param src — строка, куда производится сериализация
- * \param value — указатель на указатель на первый элемент массива
- * \param size — размер статического массива
- * \param mode — режим архива (см. ArchiveMode)
- *
- * \return Число сериализованных байт
- */
 template<typename T>
 int serialize_static(
 	std::string &src,
 	T const *value,
 	int size,
-	int mode = ArchiveMode::determine_shared_mode
-);
+	int mode
+)
+{
+	src.clear();
+	return _serialize_to_string(src, mode, [value, size](auto &arch, bool write) {
+		return serialize_static(arch, value, size, write);
+	});
+}
 
-/// Функция сериализации статического массива в строку
-/// без явного указание строки
-/*!
- * Сериализует статический массив в строку.
- *
- * \param value — указатель на указатель на первый элемент массива
- * \param size — размер статического массива
- * \param mode — режим архива (см. ArchiveMode)
- *
- * \return Строку, в которую произвелась сериализация массива
- */
 template<typename T>
 std::string serialize_static(
 	T const *value,
 	int size,
-	int mode = ArchiveMode::determine_shared_mode
-);
+	int mode
+)
+{
+	std::string res;
+	serialize_static(res, value, size, mode);
+	return res;
+}
 
 
-/// Функция десериализации статического массива из строки
-/*!
- * Десериализует статический массив из строки.
- *
- * \param src — строка, из которой производится сериализация
- * \param value — указатель на указатель на первый элемент массива
- * \param size — размер массива
- * \param mode — режим архива (см. ArchiveMode)
- *
- * \return Число десериализованных байт
- */
 template<typename T>
 int deserialize_static(
 	std::string const &src,
 	T *value,
 	int size,
-	int mode = ArchiveMode::determine_shared_mode
-);
+	int mode
+)
+{
+	memory_istream ms(src);
+	archive<decltype(ms)> arch(&ms, mode);
+
+	return deserialize_static(arch, value, size);
+}
 
-/// Функция десериализации статического массива из строки
-/// (перегрузка для rvalue)
-/*!
- * Десериализует статический массив из строки.
- *
- * \param src — строка, из которой производится сериализация
- * \param value — указатель на указатель на первый элемент массива
- * \param size — размер массива
- * \param mode — режим архива (см. ArchiveMode)
- *
- * \return Число десериализованных байт
- */
 template<typename T>
 int deserialize_static(
 	std::string &&src,
 	T *value,
 	int size,
-	int mode = ArchiveMode::determine_shared_mode
-);
+	int mode
+)
+{
+	memory_istream ms(src);
+	archive<decltype(ms)> arch(&ms, mode);
 
-/* @} */
+	return deserialize_static(arch, value, size);
+}
 
 
 
 
 
-// final
-template<class Ostream, typename Meta, typename T>
-int _serialize_final(
-	archive<Ostream, Meta> &os,
-	T const *value,
-	bool write = true
-);
+// serialized size
+template<typename T>
+constexpr int serialized_size()
+{
+	static_assert(is_fixed_size<T>::value, "Serialized size of T depends on its value");
+	return _fixed_size<T>::value;
+}
 
-template<class Ostream, typename Meta, typename T>
-int _deserialize_final(
-	archive<Ostream, Meta> &os,
-	T *value
-);
+template<typename T>
+int serialized_size(T const *value, int mode)
+{
+	if constexpr(is_fixed_size<T>::value)
+	{
+		if(!(mode & varint_mode))
+			return _fixed_size<T>::value;
+	}
+
+	size_ostream cnt;
+	archive<decltype(cnt)> arch(&cnt, mode);
+
+	serialize(arch, value);
+	return cnt.tellp();
+}
+
+
+
+
+
+
+// dynamic arrays
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize_array(
+	archive<Ostream, Meta, Mode> &os,
+	T const * const *value,
+	int const *size,
+	bool write
+)
+{
+	int res = serialize(os, size, write);
+
+	if(!*size)
+		return res;
+
+	return res + _serialize_range(os, *value, *size, write);
+}
+
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize_array(
+	archive<Istream, Meta, Mode> &is,
+	T **value,
+	int *sizeptr
+)
+{
+	int32_t size;
+	int res = deserialize(is, &size);
+	if(!res || size < 0)
+		return 0;
+
+	*sizeptr = size;
+
+	if(!size)
+	{
+		*value = nullptr;
+		return res;
+	}
+
+	*value = _new_array<T>(is, size);
+	return res + _deserialize_range(is, *value, size);
+}
+
+
+
+
+
+// static array
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize_static(
+	archive<Ostream, Meta, Mode> &os,
+	T const * value,
+	int size,
+	bool write
+)
+{
+	return _serialize_range(os, value, size, write);
+}
+
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize_static(
+	archive<Istream, Meta, Mode> &is,
+	T *value,
+	int size
+)
+{
+	return _deserialize_range(is, value, size);
+}
+
+
+
+
+
+// plain
+template<class Ostream, typename Meta, int Mode>
+int serialize_plain(
+	archive<Ostream, Meta, Mode> &os,
+	void const *obj,
+	int size,
+	bool write
+)
+{
+	_NVX_STATS_SCOPE(os, plain, write);
+
+	if(!write)
+		return size / sizeof(char);
+	return os._write( (char const *)obj, size / sizeof(char) ) ? size : 0;
+}
 
+template<class Istream, typename Meta, int Mode>
+int deserialize_plain(
+	archive<Istream, Meta, Mode> &is,
+	void *obj,
+	int size
+)
+{
+	_NVX_STATS_SCOPE(is, plain, true);
+	return is._read( (char *)obj, size / sizeof(char) ) ? size : 0;
+}
 
 
 
 
-/****************** POINTERS SERIALIZATION ******************/
-/*!
- * \defgroup pointers_serialization Сериализация указателей
- * \ingroup serialization_functions
- *
- * Эта группа содержит функции, отвечающие за сериализацию
- * указателей, как обычных так и shared; работу этих
- * функций контролирует режим архива ArchiveMode
- *
- * @{
- */
 
-/// Вспомогательная функция для сериализации обычных указателей
-/*!
- * Вспомогательная функция для сериализации,
- * которая определяет, является ли obj
- * указателем на указатель; эта перегрузка
- * вызывается, если является; если включено
- * разпознавание разделяемых обычных указателей
- * (т.е. установлен флаг determine_pointers_mode),
- * то функция ведёт себя особым образом
- */
-template<class Ostream, typename Meta, typename T>
-int _serialize_dispatcher(
-	archive<Ostream, Meta> &os,
-	T const *obj,
-	std::true_type,
-	bool write = true
-);
+// modes
+template<class Stream, typename Meta, int Mode>
+inline bool _has_mode(archive<Stream, Meta, Mode> const &a, int flag)
+{
+	return a.mode & flag;
+}
 
-/// Вспомогательная функция для сериализации обычных указателей
-/*!
- * Вспомогательная функция для сериализации,
- * которая определяет, является ли obj
- * указателем на указатель; эта перегрузка
- * вызывается, если не является
- */
-template<class Ostream, typename Meta, typename T>
-inline int _serialize_dispatcher(
-	archive<Ostream, Meta> &os,
-	T const *obj,
-	std::false_type,
-	bool write = true
-);
+template<typename T, class Stream, typename Meta, int Mode>
+inline bool _swap_enabled(archive<Stream, Meta, Mode> const &a)
+{
+	return std::is_arithmetic<T>::value && sizeof(T) > 1 &&
+		_has_mode(a, _native_big_endian ? little_endian_mode : big_endian_mode) &&
+		!(_is_varint<T>::value && _has_mode(a, varint_mode));
+}
 
 
-/// Вспомогательная функция для десериализации обычных указателей
-/*!
- * Вспомогательная функция для десериализации,
- * которая определяет, является ли obj
- * указателем на указатель; эта перегрузка
- * вызывается, если является; если включено
- * разпознавание разделяемых обычных указателей
- * (т.е. установлен флаг determine_pointers_mode),
- * то функция ведёт себя особым образом
- */
-template<class Ostream, typename Meta, typename T>
-int _deserialize_dispatcher(
-	archive<Ostream, Meta> &os,
-	T *obj,
-	std::true_type
-);
 
-/// Вспомогательная функция для десериализации обычных указателей
-/*!
- * Вспомогательная функция для десериализации,
- * которая определяет, является ли obj
- * указателем на указатель; эта перегрузка
- * вызывается, если не является
- */
-template<class Ostream, typename Meta, typename T>
-inline int _deserialize_dispatcher(
-	archive<Ostream, Meta> &os,
-	T *obj,
-	std::false_type
-);
+// ranges
+template<typename T, class Stream, typename Meta, int Mode>
+bool _bulk_enabled(archive<Stream, Meta, Mode> const &a)
+{
+	return is_bulk_serializable<T>::value &&
+		!(_is_varint<T>::value && (a.mode & varint_mode)) &&
+		!_swap_enabled<T>(a);
+}
 
+template<typename T, class Stream, typename Meta, int Mode>
+bool _fixed_enabled(archive<Stream, Meta, Mode> const &a)
+{
+	return is_fixed_size<T>::value && (
+		!(a.mode & varint_mode) ||
+		is_plain_serializable<T>::value ||
+		(std::is_arithmetic<T>::value && !_is_varint<T>::value)
+	);
+}
 
 
-// shared pointers
-/// Вспомогательная функция для сериализации std::shared_ptr
-/*!
- * Вспомогательная функция для сериализации,
- * если включено разпознавание разделяемых
- * shared_pointer (т.е. установлен флаг
- * determine_shared_mode), то функция ведёт
- * себя особым образом
- */
-template<class Ostream, typename Meta, typename T>
-int serialize(
-	archive<Ostream, Meta> &os,
-	std::shared_ptr<T> const *obj,
-	bool write = true
-);
 
-/// Вспомогательная функция для десериализации std::shared_ptr
-/*!
- * Вспомогательная функция для десериализации,
- * если включено разпознавание разделяемых
- * shared_pointer (т.е. установлен флаг
- * determine_shared_mode), то функция ведёт
- * себя особым образом
- */
-template<class Istream, typename Meta, typename T>
-int deserialize(
-	archive<Istream, Meta> &is,
-	std::shared_ptr<T> *obj
-);
+// varint
+template<typename T>
+inline std::make_unsigned_t<T> _zigzag(T value)
+{
+	typedef std::make_unsigned_t<T> U;
+	if constexpr(std::is_signed<T>::value)
+		return ((U)value << 1) ^ (U)(value < 0 ? -1 : 0);
+	return value;
+}
 
+template<typename T>
+inline T _unzigzag(std::make_unsigned_t<T> value)
+{
+	if constexpr(std::is_signed<T>::value)
+		return (T)((value >> 1) ^ -(value & 1));
+	return value;
+}
 
+// Записывает value в buf (не менее 10 байт) и возвращает длину
+template<typename U>
+inline int _encode_varint(U value, char *buf)
+{
+	int n = 0;
+	while(value >= 0x80)
+	{
+		buf[n++] = (char)(value | 0x80);
+		value >>= 7;
+	}
+	buf[n++] = (char)value;
+	return n;
+}
 
-// weak pointers
-/// Вспомогательная функция для сериализации std::weak_ptr
-template<class Ostream, typename Meta, typename T>
-int serialize(
-	archive<Ostream, Meta> &os,
-	std::weak_ptr<T> const *obj,
-	bool write = true
-);
+template<typename U>
+inline int _varint_size(U value)
+{
+	int n = 1;
+	while(value >= 0x80)
+		value >>= 7, ++n;
+	return n;
+}
 
-/// Вспомогательная функция для десериализации std::weak_ptr
-template<class Istream, typename Meta, typename T>
-int deserialize(
-	archive<Istream, Meta> &is,
-	std::weak_ptr<T> *obj
-);
+template<class Ostream, typename Meta, int Mode, typename U>
+int _serialize_varint(
+	archive<Ostream, Meta, Mode> &os,
+	U value,
+	bool write
+)
+{
+	if(!write)
+		return _varint_size(value);
 
+	char buf[16];
+	int n = _encode_varint(value, buf);
+	return os._write(buf, n) ? n : 0;
+}
 
+template<class Istream, typename Meta, int Mode, typename U>
+int _deserialize_varint(
+	archive<Istream, Meta, Mode> &is,
+	U *value
+)
+{
+	constexpr int bits = 8 * sizeof(U);
 
-// unique pointers
-/// Вспомогательная функция для сериализации std::unique_ptr
-template<class Ostream, typename Meta, typename T>
-int serialize(
-	archive<Ostream, Meta> &os,
-	std::unique_ptr<T> const *obj,
-	bool write = true
-);
+	U u = 0;
+	unsigned char c = 0;
+	int n = 0;
+	do
+	{
+		int shift = 7*n;
+		if(shift >= bits || !is._read((char *)&c, 1))
+			return 0;
 
-/// Вспомогательная функция для десериализации std::unique_ptr
-template<class Istream, typename Meta, typename T>
-int deserialize(
-	archive<Istream, Meta> &is,
-	std::unique_ptr<T> *obj
-);
+		// биты последнего байта, не умещающиеся в U, означают
+		// повреждённые данные, а не значение
+		if(bits - shift < 7 && ((c & 0x7f) >> (bits - shift)))
+			return 0;
 
-/*! @} */
+		u |= (U)(c & 0x7f) << shift;
+		++n;
+	}
+	while(c & 0x80);
 
+	*value = u;
+	return n;
+}
 
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_range(
+	archive<Ostream, Meta, Mode> &os,
+	T const *value,
+	size_t size,
+	bool write
+)
+{
+	if constexpr(is_bulk_serializable<T>::value)
+	{
+		if(_bulk_enabled<T>(os))
+		{
+			if(!write || !size)
+				return size * sizeof(T);
+			return os._write( (char const *)value, size * sizeof(T) ) ?
+				size * sizeof(T) : 0;
+		}
+	}
 
+	// числа с другим порядком байт разворачиваются через буфер
+	if constexpr(std::is_arithmetic<T>::value && sizeof(T) > 1)
+	{
+		if(_swap_enabled<T>(os))
+		{
+			if(!write)
+				return size * sizeof(T);
 
+			constexpr size_t step = 4096 / sizeof(T);
+			char buf[step * sizeof(T)];
+			for(size_t done = 0; done < size; done += step)
+			{
+				size_t n = std::min(step, size - done);
+				_byteswap_range<sizeof(T)>(buf, (char const *)(value + done), n);
+				if(!os._write(buf, n * sizeof(T)))
+					return 0;
+			}
+			return size * sizeof(T);
+		}
+	}
 
-/************************ STD-STRUCTS ***********************/
-/* STD-STRUCTS */
-/*!
- * \defgroup std_serialization Стандартные контейнеры и структуры
- * \ingroup serialization_functions
- *
- * Эти функции предназначены для сериализации стандартных
- * контейнеров и структур, а именно:
- *
- * - `pair`
- * - `vector`
- * - `list`
- * - `set`
- * - `multiset`
- * - `unordered_set`
- * - `unordered_multiset`
- * - `map`
- * - `multimap`
- * - `unordered_map`
- * - `unordered_multimap`
- *
- * Каждая функция (де)сериализации устроена по единому образцу:
- *
- * \param os — архив, с помощью которого будет производится
- * (де)сериализация
- *
- * \param obj — объект, который необходимо (де)сериализовать
- *
- * \param [write] — аргумент только для функций сериализации;
- * говорит о том, действительно ли нужно сеарилизовать объект
- * или же только возвратить необходимый для сериализации
- * размер
- * @{
- */
+	int res = 0;
+	for(auto *b = value, *e = value+size; b != e; ++b)
+		res += serialize(os, b, write);
+	return res;
+}
 
-/// Сериализация пары значений std::pair
-template<class Ostream, typename Meta, typename T, typename U>
-int serialize(
-	archive<Ostream, Meta> &os,
-	std::pair<T, U> const *p,
-	bool write = true
-);
+template<class Istream, typename Meta, int Mode, typename T>
+int _deserialize_range(
+	archive<Istream, Meta, Mode> &is,
+	T *value,
+	size_t size
+)
+{
+	if constexpr(is_bulk_serializable<T>::value)
+	{
+		if(_bulk_enabled<T>(is))
+		{
+			if(!size)
+				return 0;
+			return is._read( (char *)value, size * sizeof(T) ) ?
+				size * sizeof(T) : 0;
+		}
+	}
 
-/// Десериализация пары значений std::pair
-template<class Istream, typename Meta, typename T, typename U>
-int deserialize(
-	archive<Istream, Meta> &is,
-	std::pair<T, U> *p
-);
+	if constexpr(std::is_arithmetic<T>::value && sizeof(T) > 1)
+	{
+		if(_swap_enabled<T>(is))
+		{
+			if(!size)
+				return 0;
+			if(!is._read( (char *)value, size * sizeof(T) ))
+				return 0;
 
+			_byteswap_range<sizeof(T)>((char *)value, (char const *)value, size);
+			return size * sizeof(T);
+		}
+	}
 
+	int res = 0;
+	for(auto *b = value, *e = value+size; b != e; ++b)
+		res += deserialize(is, b);
+	return res;
+}
 
+template<class Istream, typename Meta, int Mode>
+char const *_take(archive<Istream, Meta, Mode> &is, size_t n)
+{
+	_NVX_STATS_ADD(is, reads, 1);
+	_NVX_STATS_ADD(is, read, n);
+	return is.stream()->take(n);
+}
 
+template<typename T, class Stream, typename Meta, int Mode>
+bool _padding_enabled(archive<Stream, Meta, Mode> const &a)
+{
+	// от порядка байт машины формат зависеть не должен
+	return alignof(T) > 1 && _has_mode(a, aligned_mode) &&
+		(_bulk_enabled<T>(a) || _swap_enabled<T>(a));
+}
 
-/* CONTAINERS */
+template<class Ostream, typename Meta, int Mode>
+int _serialize_padding(
+	archive<Ostream, Meta, Mode> &os,
+	size_t align,
+	bool write
+)
+{
+	static char const zeros[alignof(std::max_align_t)] = {};
 
-/// Вспомогательная функция для сериализации контейнеров
-/*!
- * Функция принимает указатель на контейнер, который
- * должен предоставлять следующие методы:
- *
- * - size() -> int32_t — размер контейнера; возвращаемое значение
- *   должно быть преобразуемо к int32_t
- * - begin() — доступ к итератору, установленному на начало
- * - end() — доступ к итератору, установленному на конец
- *
- * Соответственно, итераторы, получаемые с помощью методов
- * begin и end, должны предоставлять следующие возможности:
- *
- * - T &operator*() — получение элемента
- * - operator++() — переход на следующих элемент
- * - bool operator!=(Iterator rhs) — сравнение с другим итератором
- */
-template<class Ostream, typename Meta, class Container>
-int serialize_container(
-	archive<Ostream, Meta> &os,
-	Container const *cont,
-	bool write = true
-);
+	if(!write)
+		return align - 1;
 
+	if constexpr(_has_offset<Ostream>::value)
+	{
+		size_t pad = (align - os.stream()->offset() % align) % align;
+		return _serialize_range(os, zeros, pad, true);
+	}
+	else if constexpr(_has_tellp<Ostream>::value)
+	{
+		size_t pad = (align - (size_t)os.stream()->tellp() % align) % align;
+		return _serialize_range(os, zeros, pad, true);
+	}
+	else
+	{
+		throw "aligned_mode requires a stream with tellp";
+	}
+}
 
-/// Вспомогательная функция для десериализации контейнеров,
-/// способных изменять размер с помощью функции resize()
-/*!
- * Контейнер должен реализовывать следующие функции:
- *
- * - resize(int32_t) — задание размера контейнера
- * - begin() — доступ к итератору, установленному на начало
- * - end() — доступ к итератору, установленному на конец
- *
- * Соответственно, итераторы, получаемые с помощью методов
- * begin и end, должны предоставлять следующие возможности:
- *
- * - T &operator*() — получение элемента
- * - operator++() — переход на следующих элемент
- * - bool operator!=(Iterator rhs) — сравнение с другим итератором
- */
-template<class Istream, typename Meta, class ResizableContainer>
-int deserialize_resizable_container(
-	archive<Istream, Meta> &is,
-	ResizableContainer *cont
-);
+template<class Istream, typename Meta, int Mode>
+int _deserialize_padding(
+	archive<Istream, Meta, Mode> &is,
+	size_t align
+)
+{
+	char skip[alignof(std::max_align_t)];
 
+	if constexpr(_has_tellg<Istream>::value)
+	{
+		size_t pad = (align - (size_t)is.stream()->tellg() % align) % align;
+		return _deserialize_range(is, skip, pad);
+	}
+	else
+	{
+		throw "aligned_mode requires a stream with tellg";
+	}
+}
 
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_aligned_range(
+	archive<Ostream, Meta, Mode> &os,
+	T const *value,
+	size_t size,
+	bool write
+)
+{
+	if(!size || !_padding_enabled<T>(os))
+		return _serialize_range(os, value, size, write);
+	return _serialize_padding(os, alignof(T), write) + _serialize_range(os, value, size, write);
+}
 
-/// Вспомогательная функция для десериализации контейнеров,
-/// в которые необходимо вставлять элементы
+template<class Istream, typename Meta, int Mode, typename T>
+int _deserialize_aligned_range(
+	archive<Istream, Meta, Mode> &is,
+	T *value,
+	size_t size
+)
+{
+	if(!size || !_padding_enabled<T>(is))
+		return _deserialize_range(is, value, size);
+	return _deserialize_padding(is, alignof(T)) + _deserialize_range(is, value, size);
+}
 
-/*!
- * Контейнер должен реализовывать следующие функции:
- *
- * - clear() — удаление всех элементов контейнера
- * - insert(T) — добавление элемента в контейнер
- * - begin() — доступ к итератору, установленному на начало
- * - end() — доступ к итератору, установленному на конец
- *
- * Соответственно, итераторы, получаемые с помощью методов
- * begin и end, должны предоставлять следующие возможности:
- *
- * - T &operator*() — получение элемента
- * - operator++() — переход на следующих элемент
- * - bool operator!=(Iterator rhs) — сравнение с другим итератором
- */
 
-template<
-	typename T,
-	class Istream,
-	typename Meta,
-	class Cont
->
-int deserialize_inserted_container(
-	archive<Istream, Meta> &is,
-	Cont *cont
-);
 
+// allocation
+template<typename T, class Stream, typename Meta, int Mode>
+T *_new_object(archive<Stream, Meta, Mode> &is, bool inarena)
+{
+	typedef std::pmr::polymorphic_allocator<char> alloc_t;
 
+	if constexpr(std::uses_allocator<T, alloc_t>::value)
+	{
+		if(is.mr)
+		{
+			if(is.ar && inarena)
+				return is.ar->template create<T>( _make_using_allocator<T>(alloc_t(is.mr)) );
+			return new T( _make_using_allocator<T>(alloc_t(is.mr)) );
+		}
+	}
 
+	if(is.ar && inarena)
+		return is.ar->template create<T>();
+	return new T;
+}
 
+template<typename T, class Stream, typename Meta, int Mode>
+std::shared_ptr<T> _new_shared(archive<Stream, Meta, Mode> &is)
+{
+	/*
+	 * polymorphic_allocator сам передаёт себя конструктору
+	 * объекта, если тот поддерживает аллокаторы
+	 */
+	if(is.mr)
+		return std::allocate_shared<T>( std::pmr::polymorphic_allocator<T>(is.mr) );
+	return std::shared_ptr<T>(new T);
+}
 
-_NVX_SERIALIZABLE_RESIZABLE_CONTANER_DECLARE(std::basic_string);
+template<typename T, class Alloc>
+T _make_using_allocator(Alloc const &a)
+{
+	if constexpr(_is_pair<T>::value)
+	{
+		return T(
+			_make_using_allocator<typename T::first_type>(a),
+			_make_using_allocator<typename T::second_type>(a)
+		);
+	}
+	else if constexpr(std::uses_allocator<T, Alloc>::value)
+	{
+		if constexpr(std::is_constructible<T, std::allocator_arg_t, Alloc const &>::value)
+			return T(std::allocator_arg, a);
+		else
+			return T(a);
+	}
+	else
+	{
+		return T();
+	}
+}
 
-_NVX_SERIALIZABLE_RESIZABLE_CONTANER_DECLARE(std::vector);
-_NVX_SERIALIZABLE_RESIZABLE_CONTANER_DECLARE(std::list);
+template<typename T, class Stream, typename Meta, int Mode>
+T *_new_array(archive<Stream, Meta, Mode> &is, size_t size)
+{
+	if(is.ar)
+		return is.ar->template create_array<T>(size);
+	return new T[size];
+}
 
-_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::set);
-_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::map);
-_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::multiset);
-_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::multimap);
 
-_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::unordered_set);
-_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::unordered_map);
-_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::unordered_multiset);
-_NVX_SERIALIZABLE_INSERTED_CONTANER_DECLARE(std::unordered_multimap);
 
 
 
+// final
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_final(
+	archive<Ostream, Meta, Mode> &os,
+	T const *value,
+	std::true_type isfundamental,
+	bool write
+)
+{
+	if constexpr(_is_varint<T>::value)
+	{
+		if(os.mode & varint_mode)
+			return _serialize_varint(os, _zigzag(*value), write);
+	}
 
+	if(!write)
+		return sizeof *value;
 
+	if(_swap_enabled<T>(os))
+	{
+		char buf[sizeof *value];
+		_byteswap_scalar<sizeof *value>(buf, (char const *)value, 1);
+		return os._write(buf, sizeof buf) ? sizeof buf : 0;
+	}
 
+	return os._write( (char const *)value, sizeof *value ) ? sizeof *value : 0;
+}
 
+template<class Istream, typename Meta, int Mode, typename T>
+int _deserialize_final(
+	archive<Istream, Meta, Mode> &is,
+	T *value,
+	std::true_type isfundamental
+)
+{
+	if constexpr(_is_varint<T>::value)
+	{
+		if(is.mode & varint_mode)
+		{
+			std::make_unsigned_t<T> u = 0;
+			int n = _deserialize_varint(is, &u);
+			if(n)
+				*value = _unzigzag<T>(u);
+			return n;
+		}
+	}
 
+	if(!is._read( (char *)value, sizeof *value ))
+		return 0;
 
+	if(_swap_enabled<T>(is))
+		_byteswap_scalar<sizeof *value>((char *)value, (char const *)value, 1);
+	return sizeof *value;
+}
 
-/* DEFINITIONS */
-// main
-template<class Ostream, typename Meta, typename T>
-int serialize(
-	archive<Ostream, Meta> &os,
+
+
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_final(
+	archive<Ostream, Meta, Mode> &os,
 	T const *value,
+	std::false_type isfundamental,
 	bool write
 )
 {
-	return _serialize_dispatcher(
-		os, value,
-		typename std::is_pointer<T>::type(),
-		write
-	);
+	return value->serialize(os, write);
 }
 
-template<class Istream, typename Meta, typename T>
-int deserialize(
-	archive<Istream, Meta> &is,
-	T *value
+template<class Ostream, typename Meta, int Mode, typename T>
+int _deserialize_final(
+	archive<Ostream, Meta, Mode> &os,
+	T *value,
+	std::false_type isfundamental
 )
 {
-	return _deserialize_dispatcher(
-		is, value,
-		typename std::is_pointer<T>::type()
-	);
+	return value->deserialize(os);
 }
 
 
 
 
 
-/****************** SERIALIZATION TO STRING *****************/
-template<typename T>
-int serialize(std::string &src, T const *value, int mode)
+// pointer
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_dispatcher(
+	archive<Ostream, Meta, Mode> &os,
+	T const *obj,
+	std::true_type,
+	bool write
+)
 {
-	std::stringstream ss;
-	archive<decltype(ss)> arch(&ss, mode);
+	_NVX_STATS_SCOPE(os, pointer, write);
 
-	int res = serialize(arch, value);
-	src = std::move(ss.str());
-	return res;
-}
+	if constexpr(_tracking_mode(Mode))
+	{
+		if(os.mode & determine_pointers_mode)
+		{
+			if(!write && !os.lira)
+				throw "Can't do not write with deterime pointers and no lira";
 
-template<typename T>
-std::string serialize(T const *value, int mode)
-{
-	std::stringstream ss;
-	archive<decltype(ss)> arch(&ss, mode);
+			// в режиме varint_mode NULL_ID занимает больше всех
+			if(!write)
+			{
+				id_t tmp = NULL_ID;
+				return serialize(os, &tmp, false);
+			}
 
-	serialize(arch, value);
-	return ss.str();
+			if(*obj == nullptr)
+				return serialize(os, &NULL_ID);
+
+			if(auto it = os.objs.find(*obj))
+			{
+				_NVX_STATS_ADD(os, hits, 1);
+				int res = serialize(os, &it->first);
+
+				if(os.lira)
+					++os.lira->objs[it->first].pc;
+
+				if(os.freshness > it->second and os.lira)
+				{
+					it->second = os.freshness;
+					int p = os._tellp();
+					os.lira->_put(it->first, *obj, 2);
+					os._seekp(p);
+				}
+
+				return res;
+			}
+
+			_NVX_STATS_ADD(os, misses, 1);
+			id_t id = os.newid();
+			int res = serialize(os, &id);
+
+			os.objs[*obj] = { id, os.freshness };
+			os.idns[id]  = { (void *)*obj, &_type_tag<T>::tag };
+
+			if(!os.lira)
+				return res + _serialize_pointee(os, *obj, true);
+
+			os.lira->shps[os.curid].insert(id);
+			int p = os._tellp();
+			int curid = os.curid;
+			os.lira->_put(id, *obj, 2);
+			os.curid = curid;
+			++os.lira->objs[id].pc;
+			os._seekp(p);
+			return res;
+		}
+	}
+
+	byte check = 0;
+
+	if(*obj == nullptr)
+		return serialize(os, &check, write);
+
+	check = 1;
+	return serialize(os, &check, write) + _serialize_pointee(os, *obj, write);
 }
 
-template<typename T>
-int deserialize(std::string const &src, T *value, int mode)
+template<class Ostream, typename Meta, int Mode, typename T>
+inline int _serialize_dispatcher(
+	archive<Ostream, Meta, Mode> &os,
+	T const *obj,
+	std::false_type,
+	bool write
+)
 {
-	std::stringstream ss(src);
-	archive<decltype(ss)> arch(&ss, mode);
-
-	return deserialize(arch, value);
+	// плоские структуры учитываются в serialize_plain
+	if constexpr(std::is_fundamental<T>::value)
+	{
+		_NVX_STATS_SCOPE(os, fundamental, write);
+		return _serialize_final(os, obj, std::true_type(), write);
+	}
+	else
+	{
+		_NVX_STATS_SCOPE(os, object, write && !is_plain_serializable<T>::value);
+		return _serialize_final(os, obj, std::false_type(), write);
+	}
 }
 
-template<typename T>
-int deserialize( std::string &&src, T *value, int mode )
+template<class Istream, typename Meta, int Mode, typename T>
+int _deserialize_dispatcher(
+	archive<Istream, Meta, Mode> &is,
+	T *obj,
+	std::true_type
+)
 {
-	std::stringstream ss(std::move(src));
-	archive<decltype(ss)> arch(&ss, mode);
+	_NVX_STATS_SCOPE(is, pointer, true);
 
-	return deserialize(arch, value);
-}
+	if constexpr(_tracking_mode(Mode))
+	{
+		if(is.mode & determine_pointers_mode)
+		{
+			id_t id = NULL_ID;
+			int res = deserialize(is, &id);
 
+			if(id == NULL_ID)
+			{
+				*obj = nullptr;
+				return res;
+			}
+
+			if(auto it = is.idns.find(id))
+			{
+				_NVX_STATS_ADD(is, hits, 1);
+				*obj = it->template get<T>();
+				return res;
+			}
 
+			_NVX_STATS_ADD(is, misses, 1);
+			*obj = _new_object<typename std::remove_pointer<T>::type>(is);
+			is.idns[id] = { (void *)*obj, &_type_tag<T>::tag };
+			is.objs[*obj] = { id, is.freshness };
 
-// to string dynamic array
-template<typename T>
-int serialize_array(
-	std::string &src,
-	T const * const *value,
-	int const *size,
-	int mode
+			if(is.lira)
+			{
+				// TODO: сделать широкий поиск вместо глубокого
+				int p = is._tellg();
+				is.lira->get(id, *obj);
+				is._seekg(p);
+			}
+			else
+			{
+				res += _deserialize_pointee(is, *obj);
+			}
+
+			return res;
+		}
+	}
+
+	byte check = 0;
+
+	int res = deserialize(is, &check);
+	if(!check)
+	{
+		*obj = nullptr;
+		return res;
+	}
+
+	*obj = _new_object<typename std::remove_pointer<T>::type>(is);
+	res += _deserialize_pointee(is, *obj);
+	return res;
+}
+
+template<class Ostream, typename Meta, int Mode, typename T>
+inline int _deserialize_dispatcher(
+	archive<Ostream, Meta, Mode> &os,
+	T *obj,
+	std::false_type
 )
 {
-	std::stringstream ss;
-	archive<decltype(ss)> arch(&ss, mode);
+	if constexpr(std::is_fundamental<T>::value)
+	{
+		_NVX_STATS_SCOPE(os, fundamental, true);
+		return _deserialize_final(os, obj, std::true_type());
+	}
+	else
+	{
+		_NVX_STATS_SCOPE(os, object, !is_plain_serializable<T>::value);
+		return _deserialize_final(os, obj, std::false_type());
+	}
+}
+
+
 
-	int res = serialize(arch, value, size);
-	src = std::move(ss.str());
-	return res;
+// pointees
+template<class Ostream, typename Meta, int Mode, typename T>
+int _run_serialize_task(archive<Ostream, Meta, Mode> &os, void *obj, bool write)
+{
+	return serialize(os, (T const *)obj, write);
 }
 
-template<typename T>
-std::string serialize_array(
-	T const * const *value,
-	int const *size,
-	int mode
-)
+template<class Istream, typename Meta, int Mode, typename T>
+int _run_deserialize_task(archive<Istream, Meta, Mode> &is, void *obj, bool)
 {
-	std::stringstream ss;
-	archive<decltype(ss)> arch(&ss, mode);
-
-	serialize(arch, value, size);
-	return ss.str();
+	return deserialize(is, (T *)obj);
 }
 
-
-template<typename T>
-int deserialize_array(
-	std::string const &src,
-	T **value,
-	int *size,
-	int mode
+template<class Ostream, typename Meta, int Mode, typename T>
+int _serialize_pointee(
+	archive<Ostream, Meta, Mode> &os,
+	T const *obj,
+	bool write
 )
 {
-	std::stringstream ss(src);
-	archive<decltype(ss)> arch(&ss, mode);
+	if( !(os.mode & iterative_mode) || os.lira )
+		return serialize(os, obj, write);
 
-	return deserialize(arch, value, size);
+	os.tasks.push_back({ &_run_serialize_task<Ostream, Meta, Mode, T>, (void *)obj, write });
+	return os.traversing ? 0 : _run_tasks(os);
 }
 
-template<typename T>
-int deserialize_array(
-	std::string &&src,
-	T **value,
-	int *size,
-	int mode
+template<class Istream, typename Meta, int Mode, typename T>
+int _deserialize_pointee(
+	archive<Istream, Meta, Mode> &is,
+	T *obj
 )
 {
-	std::stringstream ss(std::move(src));
-	archive<decltype(ss)> arch(&ss, mode);
+	if( !(is.mode & iterative_mode) || is.lira )
+		return deserialize(is, obj);
 
-	return deserialize(arch, value, size);
+	is.tasks.push_back({ &_run_deserialize_task<Istream, Meta, Mode, T>, (void *)obj, false });
+	return is.traversing ? 0 : _run_tasks(is);
 }
 
+template<class Stream, typename Meta, int Mode>
+int _run_tasks(archive<Stream, Meta, Mode> &a)
+{
+	/*
+	 * Объекты обрабатываются в порядке постановки в очередь,
+	 * одинаковом при записи и при чтении; вложенные указатели
+	 * только дополняют очередь, так что глубина рекурсии не
+	 * зависит от длины цепочки указателей
+	 */
+	int res = 0;
+	a.traversing = true;
 
+	try
+	{
+		while(!a.tasks.empty())
+		{
+			auto task = a.tasks.front();
+			a.tasks.pop_front();
+			res += task.run(a, task.obj, task.write);
+		}
 
-// to string static array
-template<typename T>
-int serialize_static(
-	std::string &src,
-	T const *value,
-	int size,
-	int mode
-)
-{
-	std::stringstream ss;
-	archive<decltype(ss)> arch(&ss, mode);
+		// все объекты прочитаны, отложенные действия
+		// выполняются в порядке откладывания
+		for(size_t i = 0; i < a.deferred.size(); ++i)
+			a.deferred[i].run(a.deferred[i].obj);
+	}
+	catch(...)
+	{
+		a.tasks.clear();
+		a.deferred.clear();
+		a.traversing = false;
+		throw;
+	}
 
-	int res = serialize_static(arch, value, size);
-	src = std::move(ss.str());
+	a.deferred.clear();
+	a.traversing = false;
 	return res;
 }
 
-template<typename T>
-std::string serialize_static(
-	T const *value,
-	int size,
-	int mode
-)
+template<class Stream, typename Meta, int Mode>
+inline bool _traversing(archive<Stream, Meta, Mode> const &a)
 {
-	std::stringstream ss;
-	archive<decltype(ss)> arch(&ss, mode);
-
-	serialize_static(arch, value, size);
-	return ss.str();
+	return a.traversing;
 }
 
-
 template<typename T>
-int deserialize_static(
-	std::string const &src,
-	T *value,
-	int size,
-	int mode
-)
+void _run_deferred_hook(void *obj)
 {
-	std::stringstream ss(src);
-	archive<decltype(ss)> arch(&ss, mode);
-
-	return deserialize_static(arch, value, size);
+	((T *)obj)->after_deserialization();
+	return;
 }
 
-template<typename T>
-int deserialize_static(
-	std::string &&src,
-	T *value,
-	int size,
-	int mode
-)
+template<class Istream, typename Meta, int Mode, typename T>
+bool _defer_after_deserialization(archive<Istream, Meta, Mode> &is, T *obj)
 {
-	std::stringstream ss(std::move(src));
-	archive<decltype(ss)> arch(&ss, mode);
+	if constexpr(_has_deserialization_hooks<T>::value)
+	{
+		if(is.traversing)
+		{
+			is.deferred.push_back({ &_run_deferred_hook<T>, (void *)obj, nullptr });
+			return true;
+		}
+	}
 
-	return deserialize_static(arch, value, size);
+	return false;
 }
 
 
 
-
-
-// dynamic arrays
-template<class Ostream, typename Meta, typename T>
-int serialize_array(
-	archive<Ostream, Meta> &os,
-	T const * const *value,
-	int const *size,
+// shared pointers
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	std::shared_ptr<T> const *obj,
 	bool write
 )
 {
-	int res = serialize(os, size, write);
+	_NVX_STATS_SCOPE(os, shared, write);
 
-	if(!*size)
-		return res;
+	if constexpr(_tracking_mode(Mode))
+	{
+		if(os.mode & determine_shared_mode)
+		{
+			if(!write && !os.lira)
+				throw "Can't do not write when deterimne shared mode on and no lira";
+
+			/*
+			 * Если необходимо только посчитать число записанных
+			 * байт, то (раз Лира есть) это всего лишь один
+			 * идентификатор (в режиме varint_mode берём самый
+			 * длинный — NULL_ID)
+			 */
+			if(!write)
+			{
+				id_t tmp = NULL_ID;
+				return serialize(os, &tmp, false);
+			}
 
-	for(auto *b = *value, *e = *value+*size; b != e; ++b)
-		res += serialize(os, b, write);
+			/*
+			 * Если объект нулевой, то записываем нулевой id
+			 */
+			if(!obj->get())
+				return serialize(os, &NULL_ID);
+
+			/*
+			 * Если объект уже был сериализован ранее, то
+			 * проверям, может быть, его нужно обновить;
+			 * обновление поддерживается, только если есть Лира
+			 */
+			if(auto it = os.objs.find(obj->get()))
+			{
+				_NVX_STATS_ADD(os, hits, 1);
+				int res = serialize(os, &it->first);
 
-	return res;
+				if(os.lira)
+					++os.lira->objs[it->first].pc;
+
+				if(os.freshness > it->second and os.lira)
+				{
+					it->second = os.freshness;
+					int p = os._tellp();
+					os.lira->_put(it->first, obj->get(), 2);
+					os._seekp(p);
+				}
+
+				return res;
+			}
+
+			/*
+			 * Если объект новый, то присваиваем ему уникальный
+			 * идентификатор и добавляем в имеющиеся
+			 */
+			_NVX_STATS_ADD(os, misses, 1);
+			id_t id = os.newid();
+			int res = serialize(os, &id);
+
+			os.objs[obj->get()] = { id, os.freshness };
+			os.idns[id] = {
+				(void *)obj->get(),
+				&_type_tag<std::shared_ptr<T>>::tag,
+				std::const_pointer_cast<void>(std::shared_ptr<void const>(*obj))
+			};
+
+			/*
+			 * Если Лиры нет, то мы просто записываем новый
+			 * объект сплошняком
+			 */
+			if(!os.lira)
+				return res + _serialize_pointee(os, obj->get(), true);
+
+			/*
+			 * Если же Лира есть, то добавляем новый объект
+			 * через неё
+			 */
+			os.lira->shps[os.curid].insert(id);
+			int p = os._tellp();
+			int curid = os.curid;
+			os.lira->_put(id, obj->get(), 2);
+			os.curid = curid;
+			++os.lira->objs[id].pc;
+			os._seekp(p);
+			return res;
+		}
+	}
+
+	/*
+	 * Если разделяемые указатели не поддерживаются, просто
+	 * записываем данные (добавляем также проверочный байт,
+	 * который сообщит, если указатель нулевой)
+	 */
+	byte check = 0;
+
+	if(obj->get() == nullptr)
+		return serialize(os, &check, write);
+
+	check = 1;
+	return serialize(os, &check, write) + _serialize_pointee(os, obj->get(), write);
 }
 
-template<class Istream, typename Meta, typename T>
-int deserialize_array(
-	archive<Istream, Meta> &is,
-	T **value,
-	int *sizeptr
+/// Вспомогательная функция для десериализации std::shared_pointer
+/*!
+ * Вспомогательная функция для десериализации,
+ * если включено разпознавание разделяемых
+ * shared_pointer (т.е. установлен флаг
+ * determine_shared_mode), то функция ведёт
+ * себя особым образом
+ */
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	std::shared_ptr<T> *obj
 )
 {
-	int32_t size;
-	int res = deserialize(is, &size);
-	*sizeptr = size;
+	_NVX_STATS_SCOPE(is, shared, true);
 
-	if(!size)
+	if constexpr(_tracking_mode(Mode))
 	{
-		*value = nullptr;
-		return res;
+		if(is.mode & determine_shared_mode)
+		{
+			/*
+			 * Если же разделяемые указатели поддерживаются, то
+			 * они всегда характеризуются уникальным идентификатором;
+			 * считываем его; проверяем, не ноль ли он
+			 */
+			id_t id = NULL_ID;
+			int res = deserialize(is, &id);
+
+			if(id == NULL_ID)
+			{
+				*obj = std::shared_ptr<T>(nullptr);
+				return res;
+			}
+
+			/*
+			 * Если объект присутствует в оперативной
+			 * памяти, то просто возвращаем его
+			 */
+			if(auto it = is.idns.find(id))
+			{
+				_NVX_STATS_ADD(is, hits, 1);
+				*obj = it->template get_shared<T>();
+				return res;
+			}
+
+			_NVX_STATS_ADD(is, misses, 1);
+			/*
+			 * Если же объекта в оперативной памяти нет,
+			 * то его нужно добавить, а затем считать
+			 * (именно в таком порядке! иначе при цикли-
+			 * ческих ссылках сериализация зациклится
+			 * в бесконечность и будет переполнение стека)
+			 */
+			*obj = _new_shared<T>(is);
+			is.idns[id] = {
+				(void *)obj->get(),
+				&_type_tag<std::shared_ptr<T>>::tag,
+				std::const_pointer_cast<void>(std::shared_ptr<void const>(*obj))
+			};
+			is.objs[obj->get()] = { id, is.freshness };
+
+			/*
+			 * Если Лира есть, то получаем объект через неё;
+			 * иначе объект находится здесь же, просто
+			 * считываем его
+			 */
+			if(is.lira)
+			{
+				// TODO: сделать широкий поиск вместо глубокого
+				int p = is._tellg();
+				is.lira->get(id, obj->get());
+				is._seekg(p);
+			}
+			else
+			{
+				res += _deserialize_pointee(is, obj->get());
+			}
+
+			return res;
+		}
 	}
 
-	*value = new T[size];
-	for(auto *b = *value, *e = *value+size; b != e; ++b)
-		res += deserialize(is, b);
+	/*
+	 * Если разделяемые указатели не поддерживаются, то
+	 * просто считываем объект, как часть существующего,
+	 * не забыв проверить, не ноль ли он
+	 */
+	byte check = 0;
+
+	int res = deserialize(is, &check);
+	if(!check)
+	{
+		*obj = std::shared_ptr<T>(nullptr);
+		return res;
+	}
 
+	*obj = _new_shared<T>(is);
+	res += _deserialize_pointee(is, obj->get());
 	return res;
 }
 
 
 
-
-
-// static array
-template<class Ostream, typename Meta, typename T>
-int serialize_static(
-	archive<Ostream, Meta> &os,
-	T const * value,
-	int size,
+// weak pointers
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	std::weak_ptr<T> const *obj,
 	bool write
 )
 {
-	int res = 0;
-	for(auto *b = value, *e = value+size; b != e; ++b)
-		res += serialize(os, b, write);
-	return res;
+	byte check = 0;
+	if(obj->expired())
+	{
+		return serialize(os, &check, write);
+	}
+
+	check = 1;
+	auto p = obj->lock();
+	return serialize(os, &check, write) + serialize(os, &p, write);
 }
 
-template<class Istream, typename Meta, typename T>
-int deserialize_static(
-	archive<Istream, Meta> &is,
-	T *value,
-	int size
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	std::weak_ptr<T> *obj
 )
 {
-	int res = 0;
-	for(auto *b = value, *e = value+size; b != e; ++b)
-		res += deserialize(is, b);
-	return res;
-}
+	byte check = 0;
 
+	int res = deserialize(is, &check);
+	if(!check)
+	{
+		*obj = std::weak_ptr<T>();
+		return res;
+	}
 
+	std::shared_ptr<T> val;
+	res += deserialize(is, &val);
+	*obj = val;
+	return res;
+}
 
 
 
-// plain
-template<class Ostream, typename Meta>
-int serialize_plain(
-	archive<Ostream, Meta> &os,
-	void const *obj,
-	int size,
+// unique pointers
+template<class Ostream, typename Meta, int Mode, typename T>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	std::unique_ptr<T> const *obj,
 	bool write
 )
 {
-	if(!write)
-		return size / sizeof(char);
-	os.s->write( (char const *)obj, size / sizeof(char) );
-	return os ? size : 0;
+	_NVX_STATS_SCOPE(os, pointer, write);
+
+	byte check = 0;
+	if(obj->get() == nullptr)
+		return serialize(os, &check, write);
+
+	check = 1;
+	return serialize(os, &check, write) + _serialize_pointee(os, obj->get(), write);
 }
 
-template<class Istream, typename Meta>
-int deserialize_plain(
-	archive<Istream, Meta> &is,
-	void *obj,
-	int size
+template<class Istream, typename Meta, int Mode, typename T>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	std::unique_ptr<T> *obj
 )
 {
-	is.s->read( (char *)obj, size / sizeof(char) );
-	return is ? size : 0;
+	_NVX_STATS_SCOPE(is, pointer, true);
+
+	byte check = 0;
+
+	int res = deserialize(is, &check);
+	if(!check)
+	{
+		*obj = std::unique_ptr<T>(nullptr);
+		return res;
+	}
+
+	*obj = std::unique_ptr<T>( _new_object<T>(is, false) );
+	res += _deserialize_pointee(is, obj->get());
+	return res;
 }
 
 
 
 
 
-// final
-template<class Ostream, typename Meta, typename T>
-int _serialize_final(
-	archive<Ostream, Meta> &os,
-	T const *value,
-	std::true_type isfundamental,
+/* STD-STRUCTS */
+
+template<
+	class Ostream,
+	typename Meta, int Mode,
+	typename T,
+	typename U
+>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	std::pair<T, U> const *p,
 	bool write
 )
 {
-	if(!write)
-		return sizeof *value;
-	os.s->write( (char const *)value, sizeof *value );
-	return (bool)os ? sizeof *value : 0;
+	return serialize(os, &p->first, write) + serialize(os, &p->second, write);
 }
 
-template<class Istream, typename Meta, typename T>
-int _deserialize_final(
-	archive<Istream, Meta> &is,
-	T *value,
-	std::true_type isfundamental
+template<
+	class Istream,
+	typename Meta, int Mode,
+	typename T,
+	typename U
+>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	std::pair<T, U> *p
 )
 {
-	is.s->read( (char *)value, sizeof *value );
-	return (bool)is ? sizeof *value : 0;
+	return deserialize(is, &p->first) + deserialize(is, &p->second);
 }
 
 
 
-template<class Ostream, typename Meta, typename T>
-int _serialize_final(
-	archive<Ostream, Meta> &os,
-	T const *value,
-	std::false_type isfundamental,
+// views
+template<
+	class Ostream,
+	typename Meta, int Mode,
+	typename C,
+	typename Traits
+>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	std::basic_string_view<C, Traits> const *view,
 	bool write
 )
 {
-	return value->serialize(os, write);
+	int32_t size = view->size();
+	return serialize(os, &size, write) + _serialize_range(os, view->data(), size, write);
 }
 
-template<class Ostream, typename Meta, typename T>
-int _deserialize_final(
-	archive<Ostream, Meta> &os,
-	T *value,
-	std::false_type isfundamental
+template<
+	class Istream,
+	typename Meta, int Mode,
+	typename C,
+	typename Traits
+>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	std::basic_string_view<C, Traits> *view
 )
 {
-	return value->deserialize(os);
-}
+	static_assert(
+		_has_take<Istream>::value,
+		"string_view can only be deserialized from a memory stream"
+	);
 
+	if(!_bulk_enabled<C>(is))
+		throw "string_view characters are not stored as is in this archive mode";
 
+	int32_t size;
+	int res = deserialize(is, &size);
+	if(!res || size < 0)
+		return 0;
 
+	char const *p = _take(is, size * sizeof(C));
+	if(!p)
+		return 0;
 
+	*view = std::basic_string_view<C, Traits>((C const *)p, size);
+	return res + size * sizeof(C);
+}
 
-// pointer
-template<class Ostream, typename Meta, typename T>
-int _serialize_dispatcher(
-	archive<Ostream, Meta> &os,
-	T const *obj,
-	std::true_type,
+template<
+	class Ostream,
+	typename Meta, int Mode,
+	typename T
+>
+int serialize(
+	archive<Ostream, Meta, Mode> &os,
+	span<T> const *view,
 	bool write
 )
 {
-	if( !(os.mode & determine_pointers_mode) )
-	{
-		byte check = 0;
+	int32_t size = view->size();
+	return serialize(os, &size, write) + _serialize_aligned_range(os, view->data(), size, write);
+}
 
-		if(*obj == nullptr)
-			return serialize(os, &check, write);
+template<
+	class Istream,
+	typename Meta, int Mode,
+	typename T
+>
+int deserialize(
+	archive<Istream, Meta, Mode> &is,
+	span<T> *view
+)
+{
+	static_assert(
+		_has_take<Istream>::value,
+		"span can only be deserialized from a memory stream"
+	);
+	static_assert(
+		is_bulk_serializable<T>::value,
+		"span elements must be bulk serializable"
+	);
 
-		check = 1;
-		return serialize(os, &check, write) + serialize(os, *obj, write);
-	}
+	if(!_bulk_enabled<T>(is))
+		throw "span elements are not stored as is in this archive mode";
 
-	if(!write && !os.lira)
-		throw "Can't do not write with deterime pointers and no lira";
+	int32_t size;
+	int res = deserialize(is, &size);
+	if(!res || size < 0)
+		return 0;
 
-	if(!write)
-	{
-		id_t tmp;
-		return serialize(os, &tmp, false);
-	}
+	if(size && _padding_enabled<T>(is))
+		res += _deserialize_padding(is, alignof(T));
 
-	if(*obj == nullptr)
-		return serialize(os, &NULL_ID);
+	char const *p = _take(is, size * sizeof(T));
+	if(!p)
+		return 0;
 
-	auto it = os.objs.find(*obj);
-	if(it != os.objs.end())
+	if(!size)
 	{
-		int res = serialize(os, &it->second.first);
-
-		if(os.lira)
-			++os.lira->objs[it->second.first].pc;
-
-		if(os.freshness > it->second.second and os.lira)
-		{
-			it->second.second = os.freshness;
-			int p = os.s->tellp();
-			os.lira->_put(it->second.first, *obj, 2);
-			os.s->seekp(p);
-		}
-
+		*view = span<T>();
 		return res;
 	}
 
-	id_t id = os.newid();
-	int res = serialize(os, &id);
+	if((uintptr_t)p % alignof(T))
+		throw "Misaligned span data, serialize it with aligned_mode";
 
-	os.objs[*obj] = { id, os.freshness };
-	os.idns[id]  = { *obj, *obj };
+	*view = span<T>((T const *)p, size);
+	return res + size * sizeof(T);
+}
 
-	if(!os.lira)
-		return res + serialize(os, *obj);
 
-	os.lira->shps[os.curid].insert(id);
-	int p = os.s->tellp();
-	int curid = os.curid;
-	os.lira->_put(id, *obj, 2);
-	os.curid = curid;
-	++os.lira->objs[id].pc;
-	os.s->seekp(p);
-	return res;
-}
 
-template<class Ostream, typename Meta, typename T>
-inline int _serialize_dispatcher(
-	archive<Ostream, Meta> &os,
-	T const *obj,
-	std::false_type,
+
+
+/* CONTAINERS */
+template<
+	class Ostream,
+	typename Meta, int Mode,
+	class Container
+>
+int serialize_container(
+	archive<Ostream, Meta, Mode> &os,
+	Container const *cont,
 	bool write
 )
 {
-	return _serialize_final(os, obj, typename std::is_fundamental<T>::type(), write);
-}
+	_NVX_STATS_SCOPE(os, container, write);
 
-template<class Istream, typename Meta, typename T>
-int _deserialize_dispatcher(
-	archive<Istream, Meta> &is,
-	T *obj,
-	std::true_type
-)
-{
-	if( !(is.mode & determine_pointers_mode) )
+	if constexpr(!_is_string<Container>::value)
 	{
-		byte check = 0;
+		if(_has_mode(os, chunked_mode))
+			return _serialize_chunked_container(os, cont, write);
+	}
+
+	int res = 0;
+	int32_t size = cont->size();
+
+	if( !(res = serialize(os, &size, write)) )
+		return 0;
 
-		int res = deserialize(is, &check);
-		if(!check)
+	if constexpr(_is_unordered_container<Container>::value)
+	{
+		if(_has_mode(os, hash_geometry_mode))
 		{
-			*obj = nullptr;
-			return res;
+			ullong buckets = cont->bucket_count();
+			float  load    = cont->max_load_factor();
+			res += serialize(os, &buckets, write) + serialize(os, &load, write);
 		}
-
-		*obj = new typename std::remove_pointer<T>::type;
-		res += deserialize(is, *obj);
-		return res;
 	}
 
-	id_t id = NULL_ID;
-	int res = deserialize(is, &id);
-
-	if(id == NULL_ID)
+	if constexpr(_is_delta_container<Container>::value)
 	{
-		*obj = nullptr;
-		return res;
+		if(_has_mode(os, delta_mode))
+			return res + _serialize_delta_container(os, cont, write);
 	}
 
-	if(auto it = is.idns.find(id); it != is.idns.end())
+	typedef typename Container::value_type value_t;
+	if constexpr(is_fixed_size<value_t>::value)
 	{
-		*obj = std::any_cast<T>(it->second.second);
-		return res;
+		if(!write && _fixed_enabled<value_t>(os))
+		{
+			// наибольшее выравнивание, как в _serialize_padding
+			if constexpr(_is_contiguous_container<Container>::value)
+			{
+				if(size && _padding_enabled<value_t>(os))
+					res += alignof(value_t) - 1;
+			}
+			return res + size * _fixed_size<value_t>::value;
+		}
 	}
 
-	*obj = new typename std::remove_pointer<T>::type;
-	is.idns[id] = { *obj, *obj };
-	is.objs[*obj] = { id, is.freshness };
+	if constexpr(_is_contiguous_container<Container>::value)
+		return res + _serialize_aligned_range(os, cont->data(), size, write);
 
-	if(is.lira)
-	{
-		// TODO: сделать широкий поиск вместо глубокого
-		int p = is.s->tellg();
-		is.lira->get(id, *obj);
-		is.s->seekg(p);
-	}
-	else
-	{
-		res += deserialize(is, *obj);
-	}
+	for(auto b = cont->begin(), e = cont->end(); b != e; ++b)
+		res += serialize(os, &*b, write);
 
 	return res;
 }
 
-template<class Ostream, typename Meta, typename T>
-inline int _deserialize_dispatcher(
-	archive<Ostream, Meta> &os,
-	T *obj,
-	std::false_type
-)
-{
-	return _deserialize_final(os, obj, typename std::is_fundamental<T>::type());
-}
-
-
-
 
 
-// shared pointers
-template<class Ostream, typename Meta, typename T>
-int serialize(
-	archive<Ostream, Meta> &os,
-	std::shared_ptr<T> const *obj,
-	bool write
+template<
+	class Istream,
+	typename Meta, int Mode,
+	class ResizableContainer
+>
+int deserialize_resizable_container(
+	archive<Istream, Meta, Mode> &is,
+	ResizableContainer *cont
 )
 {
-	/*
-	 * Если разделяемые указатели не поддерживаются, просто
-	 * записываем данные (добавляем также проверочный байт,
-	 * который сообщит, если указатель нулевой)
-	 */
-	if( !(os.mode & determine_shared_mode) )
-	{
-		byte check = 0;
-
-		if(obj->get() == nullptr)
-			return serialize(os, &check, write);
-
-		check = 1;
-		return serialize(os, &check, write) + serialize(os, obj->get(), write);
-	}
-
-	if(!write && !os.lira)
-		throw "Can't do not write when deterimne shared mode on and no lira";
+	_NVX_STATS_SCOPE(is, container, true);
 
-	/*
-	 * Если необходимо только посчитать число записанных
-	 * байт, то (раз Лира есть) это всего лишь один
-	 * идентификатор
-	 */
-	if(!write)
+	if constexpr(!_is_string<ResizableContainer>::value)
 	{
-		id_t tmp;
-		return serialize(os, &tmp, false);
+		if(_has_mode(is, chunked_mode))
+		{
+			cont->clear();
+			return _deserialize_chunks(is, [&](int32_t size) {
+				/*
+				 * Вектор перемещает элементы, когда растёт, а во время
+				 * обхода очереди в режиме iterative_mode на них могут
+				 * ссылаться отложенные действия, поэтому элементы
+				 * дописываются в конце обхода
+				 */
+				typedef typename ResizableContainer::value_type value_t;
+				if constexpr(
+					_is_contiguous_container<ResizableContainer>::value &&
+					!is_bulk_serializable<value_t>::value
+				)
+				{
+					if(_traversing(is))
+						return _deserialize_inserted_elements(is, cont, size);
+				}
+
+				size_t old = cont->size();
+				cont->resize(old + size);
+
+				if constexpr(_is_contiguous_container<ResizableContainer>::value)
+					return _deserialize_aligned_range(is, cont->data() + old, size);
+
+				int res = 0;
+				for(auto b = std::prev(cont->end(), size), e = cont->end(); b != e; ++b)
+					res += deserialize(is, &*b);
+				return res;
+			});
+		}
 	}
 
-	/*
-	 * Если объект нулевой, то записываем нулевой id
-	 */
-	if(!obj->get())
-		return serialize(os, &NULL_ID);
-
-	/*
-	 * Если объект уже был сериализован ранее, то
-	 * проверям, может быть, его нужно обновить;
-	 * обновление поддерживается, только если есть Лира
-	 */
-	auto it = os.objs.find(obj->get());
-	if(it != os.objs.end())
-	{
-		int res = serialize(os, &it->second.first);
+	int res = 0;
+	int32_t size;
 
-		if(os.lira)
-			++os.lira->objs[it->second.first].pc;
+	if( !(res = deserialize(is, &size)) )
+		return 0;
 
-		if(os.freshness > it->second.second and os.lira)
-		{
-			it->second.second = os.freshness;
-			int p = os.s->tellp();
-			os.lira->_put(it->second.first, obj->get(), 2);
-			os.s->seekp(p);
-		}
+	// части записаны подряд, так что таблица смещений не нужна
+	if(size == INDEXED_MARK)
+	{
+		int32_t chunk;
+		std::vector<ullong> lengths;
 
-		return res;
+		int n = _deserialize_index(is, &size, &chunk, &lengths);
+		if(!n)
+			return 0;
+		res += n;
 	}
 
-	/*
-	 * Если объект новый, то присваиваем ему уникальный
-	 * идентификатор и добавляем в имеющиеся
-	 */
-	id_t id = os.newid();
-	int res = serialize(os, &id);
+	// отрицательный размер возможен только в повреждённых данных
+	if(size < 0)
+		return 0;
 
-	os.objs[obj->get()] = { id, os.freshness };
-	os.idns[id] = { obj->get(), *obj };
+	if constexpr(_is_contiguous_container<ResizableContainer>::value)
+		return res + _deserialize_contiguous(is, cont, size);
 
-	/*
-	 * Если Лиры нет, то мы просто записываем новый
-	 * объект сплошняком
-	 */
-	if(!os.lira)
-		return res + serialize(os, obj->get());
+	cont->resize(size);
+	for(auto b = cont->begin(), e = cont->end(); b != e; ++b)
+		res += deserialize(is, &*b);
 
-	/*
-	 * Если же Лира есть, то добавляем новый объект
-	 * через неё
-	 */
-	os.lira->shps[os.curid].insert(id);
-	int p = os.s->tellp();
-	int curid = os.curid;
-	os.lira->_put(id, obj->get(), 2);
-	os.curid = curid;
-	++os.lira->objs[id].pc;
-	os.s->seekp(p);
 	return res;
 }
 
-/// Вспомогательная функция для десериализации std::shared_pointer
-/*!
- * Вспомогательная функция для десериализации,
- * если включено разпознавание разделяемых
- * shared_pointer (т.е. установлен флаг
- * determine_shared_mode), то функция ведёт
- * себя особым образом
- */
-template<class Istream, typename Meta, typename T>
-int deserialize(
-	archive<Istream, Meta> &is,
-	std::shared_ptr<T> *obj
+
+
+template<
+	class Istream,
+	typename Meta, int Mode,
+	class ContiguousContainer
+>
+int _deserialize_contiguous(
+	archive<Istream, Meta, Mode> &is,
+	ContiguousContainer *cont,
+	int32_t size
 )
 {
+	typedef typename ContiguousContainer::value_type value_t;
+
 	/*
-	 * Если разделяемые указатели не поддерживаются, то
-	 * просто считываем объект, как часть существующего,
-	 * не забыв проверить, не ноль ли он
+	 * Если поток хранит данные в памяти, то контейнер
+	 * заполняется прямо из неё, без предварительного
+	 * обнуления элементов
 	 */
-	if( !(is.mode & determine_shared_mode) )
+	if constexpr(_has_take<Istream>::value && is_bulk_serializable<value_t>::value)
 	{
-		byte check = 0;
-
-		int res = deserialize(is, &check);
-		if(!check)
+		if(_bulk_enabled<value_t>(is))
 		{
-			*obj = std::shared_ptr<T>(nullptr);
-			return res;
-		}
-
-		*obj = std::shared_ptr<T>(new T);
-		res += deserialize(is, obj->get());
-		return res;
-	}
+			int pad = 0;
+			if(size && _padding_enabled<value_t>(is))
+				pad = _deserialize_padding(is, alignof(value_t));
 
-	/*
-	 * Если же разделяемые указатели поддерживаются, то
-	 * они всегда характеризуются уникальным идентификатором;
-	 * считываем его; проверяем, не ноль ли он
-	 */
-	id_t id = NULL_ID;
-	int res = deserialize(is, &id);
+			char const *p = _take(is, size * sizeof(value_t));
+			if(!p)
+				return 0;
 
-	if(id == NULL_ID)
-	{
-		*obj = std::shared_ptr<T>(nullptr);
-		return res;
-	}
+			if((uintptr_t)p % alignof(value_t) == 0)
+			{
+				value_t const *b = (value_t const *)p;
+				cont->assign(b, b + size);
+			}
+			else
+			{
+				cont->resize(size);
+				std::copy(p, p + size * sizeof(value_t), (char *)cont->data());
+			}
 
-	/*
-	 * Если объект присутствует в оперативной
-	 * памяти, то просто возвращаем его
-	 */
-	if(auto it = is.idns.find(id); it != is.idns.end())
-	{
-		*obj = std::any_cast<std::shared_ptr<T>>(it->second.second);
-		return res;
+			return pad + size * sizeof(value_t);
+		}
 	}
 
-	/*
-	 * Если же объекта в оперативной памяти нет,
-	 * то его нужно добавить, а затем считать
-	 * (именно в таком порядке! иначе при цикли-
-	 * ческих ссылках сериализация зациклится
-	 * в бесконечность и будет переполнение стека)
-	 */
-	*obj = std::shared_ptr<T>(new T);
-	is.idns[id] = { obj->get(), *obj };
-	is.objs[obj->get()] = { id, is.freshness };
+	cont->resize(size);
+	return _deserialize_aligned_range(is, cont->data(), size);
+}
 
-	/*
-	 * Если Лира есть, то получаем объект через неё;
-	 * иначе объект находится здесь же, просто
-	 * считываем его
-	 */
-	if(is.lira)
-	{
-		// TODO: сделать широкий поиск вместо глубокого
-		int p = is.s->tellg();
-		is.lira->get(id, obj->get());
-		is.s->seekg(p);
-	}
-	else
-	{
-		res += deserialize(is, obj->get());
-	}
 
-	return res;
-}
 
+template<typename T>
+struct remove_const_from_pair
+{
+	typedef typename std::remove_const<T>::type type;
+};
 
+template<typename T, typename U>
+struct remove_const_from_pair<std::pair<T, U>>
+{
+	typedef std::pair<
+		typename std::remove_const<T>::type,
+		typename std::remove_const<U>::type
+	> type;
+};
 
-// weak pointers
-template<class Ostream, typename Meta, typename T>
-int serialize(
-	archive<Ostream, Meta> &os,
-	std::weak_ptr<T> const *obj,
-	bool write
+template<
+	class Istream,
+	typename Meta, int Mode,
+	class Cont
+>
+int deserialize_inserted_container(
+	archive<Istream, Meta, Mode> &is,
+	Cont *cont
 )
 {
-	byte check = 0;
-	if(obj->expired())
+	_NVX_STATS_SCOPE(is, container, true);
+
+	if(_has_mode(is, chunked_mode))
 	{
-		return serialize(os, &check, write);
+		cont->clear();
+		return _deserialize_chunks(is, [&](int32_t size) {
+			return _deserialize_inserted_elements(is, cont, size);
+		});
 	}
 
-	check = 1;
-	auto p = obj->lock();
-	return serialize(os, &check, write) + serialize(os, &p, write);
-}
+	int res = 0;
+	int32_t size;
+
+	if( !(res = deserialize(is, &size)) || size < 0 )
+		return 0;
+
+	cont->clear();
+
+	/*
+	 * Хеш-таблица сразу получает нужное число корзин,
+	 * чтобы не перестраиваться во время вставки. Размер
+	 * и геометрия берутся из потока, поэтому доверять им
+	 * можно лишь в пределах HASH_BUCKETS_LIMIT или числа
+	 * оставшихся байт, иначе испорченный поток заставил бы
+	 * выделить гигабайты
+	 */
+	if constexpr(_is_unordered_container<Cont>::value)
+	{
+		ullong presize = std::min<ullong>(size, HASH_BUCKETS_LIMIT);
+		if constexpr(_has_remaining<Istream>::value)
+			presize = std::max<ullong>(presize, std::min<ullong>(size, is.stream()->remaining()));
+		ullong cap = std::max<ullong>(HASH_BUCKETS_LIMIT, 2 * presize);
+
+		if(_has_mode(is, hash_geometry_mode))
+		{
+			ullong buckets;
+			float  load;
+
+			int n = deserialize(is, &buckets);
+			int m = deserialize(is, &load);
+			if(!n || !m)
+				return 0;
+			res += n + m;
+
+			if(load >= 1.0f / 64)
+				cont->max_load_factor(load);
+			cont->rehash(std::min(buckets, cap));
+		}
 
-template<class Istream, typename Meta, typename T>
-int deserialize(
-	archive<Istream, Meta> &is,
-	std::weak_ptr<T> *obj
-)
-{
-	byte check = 0;
+		if(cont->bucket_count() * cont->max_load_factor() < presize)
+			cont->rehash(std::min<ullong>(presize / cont->max_load_factor() + 1, cap));
+	}
 
-	int res = deserialize(is, &check);
-	if(!check)
+	if constexpr(_is_delta_container<Cont>::value)
 	{
-		*obj = std::weak_ptr<T>();
-		return res;
+		if(_has_mode(is, delta_mode))
+			return res + _deserialize_delta_container(is, cont, size);
 	}
 
-	std::shared_ptr<T> val;
-	res += deserialize(is, &val);
-	*obj = val;
-	return res;
+	return res + _deserialize_inserted_elements(is, cont, size);
 }
 
 
 
-// unique pointers
-template<class Ostream, typename Meta, typename T>
-int serialize(
-	archive<Ostream, Meta> &os,
-	std::unique_ptr<T> const *obj,
-	bool write
-)
+template<class Cont, typename T>
+inline void _insert_next(Cont *cont, T &&obj)
 {
-	byte check = 0;
-	if(obj->get() == nullptr)
-		return serialize(os, &check, write);
+	/*
+	 * Упорядоченные контейнеры сериализуются в порядке
+	 * возрастания, поэтому очередной элемент встаёт в конец,
+	 * и вставка с подсказкой end() занимает O(1) вместо O(log n)
+	 */
+	if constexpr(_is_ordered_container<Cont>::value)
+		cont->insert(cont->end(), std::forward<T>(obj));
+	else if constexpr(_is_contiguous_container<Cont>::value)
+		cont->push_back(std::forward<T>(obj));
+	else
+		cont->insert(std::forward<T>(obj));
+	return;
+}
 
-	check = 1;
-	return serialize(os, &check, write) + serialize(os, obj->get(), write);
+// Элементы, вставка которых в контейнер отложена до конца обхода
+template<class Cont, typename T>
+struct _deferred_insert
+{
+	Cont *cont;
+	std::deque<T> elements;
+};
+
+template<class Cont, typename T>
+void _run_deferred_insert(void *obj)
+{
+	auto *ins = (_deferred_insert<Cont, T> *)obj;
+	for(auto &el : ins->elements)
+		_insert_next(ins->cont, std::move(el));
+	ins->elements.clear();
+	return;
 }
 
-template<class Istream, typename Meta, typename T>
-int deserialize(
-	archive<Istream, Meta> &is,
-	std::unique_ptr<T> *obj
+template<
+	class Istream,
+	typename Meta, int Mode,
+	class Cont
+>
+int _deserialize_inserted_elements(
+	archive<Istream, Meta, Mode> &is,
+	Cont *cont,
+	int32_t size
 )
 {
-	byte check = 0;
+	typedef typename remove_const_from_pair<
+		typename std::remove_reference<decltype(*cont->begin())>::type
+	>::type obj_t;
 
-	int res = deserialize(is, &check);
-	if(!check)
+	int res = 0;
+
+	/*
+	 * Временный элемент получает аллокатор контейнера, чтобы
+	 * при вставке он переместился, а не скопировался в другую
+	 * память (важно для pmr-контейнеров)
+	 */
+	if(is.traversing)
 	{
-		*obj = std::unique_ptr<T>(nullptr);
+		auto ins = std::make_shared<_deferred_insert<Cont, obj_t>>();
+		ins->cont = cont;
+		for(int32_t i = 0; i < size && is; ++i)
+		{
+			ins->elements.push_back(_make_using_allocator<obj_t>(cont->get_allocator()));
+			res += deserialize(is, &ins->elements.back());
+		}
+
+		is.deferred.push_back({ &_run_deferred_insert<Cont, obj_t>, ins.get(), ins });
 		return res;
 	}
 
-	*obj = std::unique_ptr<T>(new T);
-	res += deserialize(is, obj->get());
+	for(int32_t i = 0; i < size && is; ++i)
+	{
+		obj_t obj = _make_using_allocator<obj_t>(cont->get_allocator());
+		int n = deserialize(is, &obj);
+
+		// недочитанный из обрезанного потока элемент не вставляется
+		if(!is)
+			break;
+		res += n;
+		_insert_next(cont, std::move(obj));
+	}
+
 	return res;
 }
 
 
 
-
-
-/* STD-STRUCTS */
-
 template<
 	class Ostream,
-	typename Meta,
-	typename T,
-	typename U
+	typename Meta, int Mode,
+	class Container
 >
-int serialize(
-	archive<Ostream, Meta> &os,
-	std::pair<T, U> const *p,
+int _serialize_chunked_container(
+	archive<Ostream, Meta, Mode> &os,
+	Container const *cont,
 	bool write
 )
 {
-	return serialize(os, &p->first, write) + serialize(os, &p->second, write);
+	int res = 0;
+	size_t size = cont->size();
+	auto it = cont->begin();
+
+	for(size_t done = 0; done < size; )
+	{
+		int32_t n = std::min<size_t>(size - done, CHUNK_ELEMENTS);
+		res += serialize(os, &n, write);
+
+		if constexpr(_is_contiguous_container<Container>::value)
+		{
+			res += _serialize_aligned_range(os, cont->data() + done, n, write);
+		}
+		else
+		{
+			for(int32_t i = 0; i < n; ++i, ++it)
+				res += serialize(os, &*it, write);
+		}
+
+		done += n;
+	}
+
+	int32_t end = 0;
+	return res + serialize(os, &end, write);
 }
 
 template<
 	class Istream,
-	typename Meta,
-	typename T,
-	typename U
+	typename Meta, int Mode,
+	class F
 >
-int deserialize(
-	archive<Istream, Meta> &is,
-	std::pair<T, U> *p
+int _deserialize_chunks(
+	archive<Istream, Meta, Mode> &is,
+	F const &read
 )
 {
-	return deserialize(is, &p->first) + deserialize(is, &p->second);
-}
+	int res = 0;
 
+	for(;;)
+	{
+		int32_t size;
+		int n = deserialize(is, &size);
+		if(!n || size < 0 || size > CHUNK_ELEMENTS)
+			return 0;
 
+		res += n;
+		if(!size)
+			return res;
+
+		res += read(size);
+	}
+}
 
 
 
-/* CONTAINERS */
 template<
 	class Ostream,
-	typename Meta,
-	class Container
+	typename Meta, int Mode
 >
-int serialize_container(
-	archive<Ostream, Meta> &os,
-	Container const *cont,
-	bool write
+int _serialize_index(
+	archive<Ostream, Meta, Mode> &os,
+	int32_t size,
+	int32_t chunk,
+	std::vector<ullong> const &lengths
 )
 {
-	int res = 0;
-	int32_t size = cont->size();
+	int32_t mark = INDEXED_MARK;
+	int res = serialize(os, &mark) + serialize(os, &size) + serialize(os, &chunk);
+	for(ullong len : lengths)
+		res += serialize(os, &len);
+	return res;
+}
 
-	if( !(res = serialize(os, &size, write)) )
+template<
+	class Istream,
+	typename Meta, int Mode
+>
+int _deserialize_index(
+	archive<Istream, Meta, Mode> &is,
+	int32_t *size,
+	int32_t *chunk,
+	std::vector<ullong> *lengths
+)
+{
+	int n = deserialize(is, size);
+	int m = deserialize(is, chunk);
+	if(!n || !m || *size < 0 || *chunk <= 0)
 		return 0;
 
-	for(auto b = cont->begin(), e = cont->end(); b != e; ++b)
-		res += serialize(os, &*b, write);
+	int res = n + m;
+	size_t count = ((size_t)*size + *chunk - 1) / *chunk;
+
+	lengths->clear();
+	for(size_t i = 0; i < count; ++i)
+	{
+		ullong len;
+		if( !(n = deserialize(is, &len)) )
+			return 0;
+		lengths->push_back(len);
+		res += n;
+	}
 
 	return res;
 }
@@ -2276,72 +5652,85 @@ int serialize_container(
 
 
 template<
-	class Istream,
-	typename Meta,
-	class ResizableContainer
+	class Ostream,
+	typename Meta, int Mode,
+	class Container
 >
-int deserialize_resizable_container(
-	archive<Istream, Meta> &is,
-	ResizableContainer *cont
+int _serialize_delta_container(
+	archive<Ostream, Meta, Mode> &os,
+	Container const *cont,
+	bool write
 )
 {
-	int res = 0;
-	int32_t size;
+	typedef typename Container::key_type key_t;
+	typedef std::make_unsigned_t<key_t> ukey_t;
+	constexpr bool isset = std::is_same<key_t, typename Container::value_type>::value;
 
-	if( !(res = deserialize(is, &size)) )
-		return 0;
+	int res = 0;
+	ukey_t prev = 0;
 
-	cont->resize(size);
 	for(auto b = cont->begin(), e = cont->end(); b != e; ++b)
-		res += deserialize(is, &*b);
+	{
+		key_t key;
+		if constexpr(isset)
+			key = *b;
+		else
+			key = b->first;
+
+		res += b == cont->begin() ?
+			_serialize_varint(os, _zigzag(key), write) :
+			_serialize_varint(os, (ukey_t)((ukey_t)key - prev), write);
+		prev = key;
+
+		if constexpr(!isset)
+			res += serialize(os, &b->second, write);
+	}
 
 	return res;
 }
 
-
-
-template<typename T>
-struct remove_const_from_pair
-{
-	typedef typename std::remove_const<T>::type type;
-};
-
-template<typename T, typename U>
-struct remove_const_from_pair<std::pair<T, U>>
-{
-	typedef std::pair<
-		typename std::remove_const<T>::type,
-		typename std::remove_const<U>::type
-	> type;
-};
-
 template<
 	class Istream,
-	typename Meta,
-	class Cont
+	typename Meta, int Mode,
+	class Container
 >
-int deserialize_inserted_container(
-	archive<Istream, Meta> &is,
-	Cont *cont
+int _deserialize_delta_container(
+	archive<Istream, Meta, Mode> &is,
+	Container *cont,
+	int32_t size
 )
 {
+	typedef typename Container::key_type key_t;
+	typedef std::make_unsigned_t<key_t> ukey_t;
 	typedef typename remove_const_from_pair<
-		typename std::remove_reference<decltype(*cont->begin())>::type
+		typename Container::value_type
 	>::type obj_t;
+	constexpr bool isset = std::is_same<key_t, obj_t>::value;
 
 	int res = 0;
-	int32_t size;
-
-	if( !(res = deserialize(is, &size)) )
-		return 0;
-
-	cont->clear();
+	ukey_t key = 0;
 
 	for(int32_t i = 0; i < size; ++i)
 	{
-		obj_t obj;
-		res += deserialize(is, &obj);
-		cont->insert(std::move(obj));
+		ukey_t delta;
+		int n = _deserialize_varint(is, &delta);
+		if(!n)
+			return 0;
+
+		res += n;
+		key = i ? (ukey_t)(key + delta) : (ukey_t)_unzigzag<key_t>(delta);
+
+		if constexpr(isset)
+		{
+			_insert_next(cont, (key_t)key);
+		}
+		else
+		{
+			obj_t obj = _make_using_allocator<obj_t>(cont->get_allocator());
+			obj.first = (key_t)key;
+			res += deserialize(is, &obj.second);
+			_insert_next(cont, std::move(obj));
+		}
 	}
 
 	return res;
@@ -2380,6 +5769,211 @@ _NVX_SERIALIZABLE_INSERTED_CONTANER_DEFINE(std::unordered_multimap);
 
 
 
+/* CHUNKED CONTAINERS */
+/*!
+ * \defgroup chunked_containers Потоковая (де)сериализация контейнеров
+ *
+ * Классы, которые пишут и читают контейнер по частям, не
+ * держа его в памяти целиком; формат совпадает с форматом
+ * контейнеров в режиме chunked_mode, так что записанное
+ * через container_writer можно прочитать в vector, set и т.п.
+ * архивом в режиме chunked_mode, и наоборот
+ *
+ * @{
+ */
+
+/// Запись контейнера из элементов типа T по частям
+/*!
+ * Отдельные элементы накапливаются в буфере размером с одну
+ * часть; массивы элементов записываются сразу. Контейнер
+ * завершается вызовом finish или close; деструктор завершает
+ * его сам, только если не идёт раскрутка стека, и не
+ * выпускает исключений, так что узнать об ошибке записи
+ * можно лишь через finish
+ */
+template<typename T, class Ostream, typename Meta = void, int Mode = runtime_mode>
+class container_writer
+{
+public:
+	/// \param chunk — максимальное число элементов в одной части
+	/// (от 1 до CHUNK_ELEMENTS, иначе приводится к этим границам)
+	container_writer(archive<Ostream, Meta, Mode> &os, int32_t chunk = CHUNK_ELEMENTS):
+		os(os), chunk(std::clamp(chunk, 1, CHUNK_ELEMENTS)),
+		uncaught(std::uncaught_exceptions()) {}
+
+	container_writer(container_writer const &) = delete;
+	container_writer &operator=(container_writer const &) = delete;
+
+	~container_writer()
+	{
+		// при исключении незавершённый контейнер так и остаётся
+		// без признака конца и читается как повреждённый
+		if(closed || std::uncaught_exceptions() > uncaught)
+			return;
+
+		try
+		{
+			close();
+		}
+		catch(...) {}
+	}
+
+
+
+	/// Запись одного элемента; возвращает число записанных байт
+	int write(T const &el)
+	{
+		buf.push_back(el);
+		return (int32_t)buf.size() < chunk ? 0 : flush();
+	}
+
+	/// Запись size подряд идущих в памяти элементов
+	int write(T const *els, size_t size)
+	{
+		int res = flush();
+
+		for(size_t done = 0; done < size; )
+		{
+			int32_t n = std::min<size_t>(size - done, chunk);
+			res += serialize(os, &n) + _serialize_aligned_range(os, els + done, n, true);
+			done += n;
+		}
+
+		return res;
+	}
+
+	/// Запись накопленных элементов отдельной частью
+	int flush()
+	{
+		if(buf.empty())
+			return 0;
+
+		int32_t n = buf.size();
+		int res = serialize(os, &n) + _serialize_aligned_range(os, buf.data(), n, true);
+		buf.clear();
+		return res;
+	}
+
+	/// Завершение контейнера; после него запись невозможна
+	int close()
+	{
+		if(closed)
+			return 0;
+
+		int res = flush();
+		int32_t end = 0;
+		closed = true;
+		return res + serialize(os, &end);
+	}
+
+	/// Завершение контейнера (см. close) с проверкой потока;
+	/// false, если какая-либо запись в него не удалась
+	bool finish()
+	{
+		close();
+		return (bool)os;
+	}
+
+private:
+	archive<Ostream, Meta, Mode> &os;
+	std::vector<T> buf;
+	int32_t chunk;
+	int uncaught;
+	bool closed = false;
+};
+
+
+
+/// Чтение контейнера из элементов типа T по частям
+/*!
+ * Пример:
+ * \code
+ * container_reader<Record, std::ifstream> reader(arch);
+ * std::vector<Record> batch;
+ * while(reader.next(batch, 10000))
+ *     process(batch);
+ * \endcode
+ */
+template<typename T, class Istream, typename Meta = void, int Mode = runtime_mode>
+class container_reader
+{
+public:
+	container_reader(archive<Istream, Meta, Mode> &is):
+		is(is) {}
+
+	/// Чтение очередных (не более max) элементов
+	/*!
+	 * Прежнее содержимое batch заменяется. Возвращает false,
+	 * если контейнер закончился и ничего не прочитано или
+	 * если поток повреждён (см. fail)
+	 */
+	bool next(std::vector<T> &batch, size_t max = CHUNK_ELEMENTS)
+	{
+		batch.clear();
+
+		while(batch.size() < max && !done && !failed)
+		{
+			if(!left)
+			{
+				int32_t size;
+				if(!deserialize(is, &size) || !is || size < 0 || size > CHUNK_ELEMENTS)
+				{
+					failed = true;
+					break;
+				}
+
+				left = size;
+				done = !size;
+				continue;
+			}
+
+			size_t old = batch.size();
+			size_t n   = std::min<size_t>(left, max - old);
+			batch.resize(old + n);
+
+			_deserialize_aligned_range(is, batch.data() + old, n);
+			if(!is)
+			{
+				batch.resize(old);
+				failed = true;
+				break;
+			}
+			left -= n;
+		}
+
+		return !batch.empty();
+	}
+
+	/// Прочитан ли контейнер до конца
+	bool finished() const
+	{
+		return done;
+	}
+
+	/// Было ли чтение прервано ошибкой потока
+	bool fail() const
+	{
+		return failed;
+	}
+
+private:
+	archive<Istream, Meta, Mode> &is;
+	size_t left = 0;
+	bool done   = false;
+	bool failed = false;
+};
+
+/*! @} */
+
+
+
+
+
+
+
+
+
+
 /* LIRA */
 
 struct _LiraPlace
@@ -2745,10 +6339,10 @@ public:
 
 		cats[cat].erase(id);
 
-		if(auto it = arch.idns.find(id); it != arch.idns.end())
+		if(auto it = arch.idns.find(id))
 		{
-			arch.objs.erase( arch.objs.find(it->second.first) );
-			arch.idns.erase( it );
+			arch.objs.erase(it->ptr);
+			arch.idns.erase(id);
 		}
 
 		if(auto it = shps.find(id); it != shps.end())
@@ -2790,7 +6384,7 @@ public:
 
 
 private:
-	template<typename Stream, typename M>
+	template<typename Stream, typename M, int Md>
 	friend class archive;
 
 	inline int next_shared_id()
@@ -2878,8 +6472,8 @@ private:
 	template<typename T>
 	void _put_first(int id, std::shared_ptr<T> const *o, int cat = '\0')
 	{
-		if(auto it = arch.objs.find(o->get()); it != arch.objs.end())
-			it->second.second = -1;
+		if(auto it = arch.objs.find(o->get()))
+			it->second = -1;
 		return _put(id, o, cat);
 	}
 
@@ -2963,16 +6557,16 @@ private:
 
 
 	// friends
-	template<class Ostream, typename M, typename T>
+	template<class Ostream, typename M, int Md, typename T>
 	friend int serialize(
-		archive<Ostream, M> &os,
+		archive<Ostream, M, Md> &os,
 		std::shared_ptr<T> const *obj,
 		bool write
 	);
 
-	template<class Ostream, typename M, typename T>
+	template<class Ostream, typename M, int Md, typename T>
 	friend int _serialize_dispatcher(
-		archive<Ostream, M> &os,
+		archive<Ostream, M, Md> &os,
 		T const *obj,
 		std::true_type,
 		bool write
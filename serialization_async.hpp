@@ -0,0 +1,216 @@
+#ifndef NVX_SERIALIZATION_ASYNC_HPP
+#define NVX_SERIALIZATION_ASYNC_HPP
+
+/**
+ * \file Поток вывода с записью в фоновом потоке
+ * \autor nvx
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "serialization.hpp"
+
+
+
+
+
+namespace nvx
+{
+
+
+
+
+
+/*!
+ * \addtogroup streams
+ * @{
+ */
+
+/// Поток вывода с двойной буферизацией
+/*!
+ * Данные накапливаются в одном буфере, пока отдельный поток
+ * выполнения передаёт предыдущий буфер потоку Stream; если
+ * фоновая запись ещё не закончилась, а буфер уже заполнен,
+ * запись ждёт её завершения. flush и close дожидаются, пока
+ * все данные будут переданы Stream, close также завершает
+ * фоновый поток (вызывается в деструкторе). После close
+ * поток неработоспособен, а запись в него ничего не делает.
+ *
+ * Stream используется только фоновым потоком (кроме вызова
+ * Stream::flush внутри flush, когда фоновая запись уже
+ * закончена), поэтому не должен использоваться снаружи,
+ * пока async_ostream не закрыт
+ */
+template<class Stream>
+class async_ostream
+{
+public:
+	/// \param capacity — размер каждого из двух буферов в байтах
+	/// (не меньше одного байта)
+	explicit async_ostream(Stream *s, size_t capacity = 1 << 20):
+		s(s), cap(std::max<size_t>(capacity, 1)),
+		front(new char[cap]), back(new char[cap]),
+		io(&async_ostream::run, this) {}
+
+	async_ostream(async_ostream const &) = delete;
+	async_ostream &operator=(async_ostream const &) = delete;
+
+	~async_ostream()
+	{
+		close();
+	}
+
+
+
+	inline void write(char const *data, size_t n)
+	{
+		if(closed)
+			return;
+
+		while(n)
+		{
+			size_t k = std::min(n, cap - len);
+			std::memcpy(front.get() + len, data, k);
+			len  += k;
+			data += k;
+			n    -= k;
+
+			if(len == cap)
+				submit();
+		}
+
+		return;
+	}
+
+	/// Передача всех записанных данных потоку Stream
+	/// с ожиданием завершения
+	void flush()
+	{
+		if(closed)
+			return;
+
+		submit();
+		wait();
+		s->flush();
+		return;
+	}
+
+	/// Запись оставшихся данных и завершение фонового потока
+	void close()
+	{
+		if(!io.joinable())
+			return;
+
+		flush();
+		{
+			std::lock_guard<std::mutex> lock(m);
+			stop = true;
+		}
+		ready.notify_one();
+		io.join();
+		closed = true;
+		return;
+	}
+
+	/// Неработоспособен, если Stream отказал при записи
+	/// или поток закрыт
+	inline operator bool() const
+	{
+		return !closed && !failed;
+	}
+
+	/// Число записанных байт (в том числе ещё не переданных Stream)
+	inline size_t tellp() const
+	{
+		return total + len;
+	}
+
+private:
+	// Передача заполненного буфера фоновому потоку
+	void submit()
+	{
+		if(!len)
+			return;
+
+		std::unique_lock<std::mutex> lock(m);
+		done.wait(lock, [this] { return !pending; });
+
+		std::swap(front, back);
+		backlen = len;
+		pending = true;
+		lock.unlock();
+		ready.notify_one();
+
+		total += len;
+		len = 0;
+		return;
+	}
+
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(m);
+		done.wait(lock, [this] { return !pending; });
+		return;
+	}
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(m);
+
+		for(;;)
+		{
+			ready.wait(lock, [this] { return pending || stop; });
+			if(!pending)
+				return;
+
+			lock.unlock();
+			s->write(back.get(), backlen);
+			bool ok = (bool)*s;
+			lock.lock();
+
+			if(!ok)
+				failed = true;
+			pending = false;
+			done.notify_all();
+		}
+	}
+
+	Stream *s;
+	size_t cap;
+
+	std::unique_ptr<char[]> front; // заполняется пишущим потоком
+	std::unique_ptr<char[]> back;  // передаётся Stream в фоне
+	size_t len     = 0;
+	size_t backlen = 0;
+	size_t total   = 0;
+
+	std::mutex m;
+	std::condition_variable ready;
+	std::condition_variable done;
+	bool pending = false;
+	bool stop    = false;
+	bool closed  = false; // меняется только пишущим потоком
+	std::atomic<bool> failed { false };
+
+	std::thread io;
+};
+
+/*! @} */
+
+
+
+
+
+}
+
+
+
+
+
+#endif // NVX_SERIALIZATION_ASYNC_HPP
@@ -0,0 +1,702 @@
+#ifndef NVX_SERIALIZATION_BLOCK_HPP
+#define NVX_SERIALIZATION_BLOCK_HPP
+
+/**
+ * \file Потоки, сжимающие данные архива блоками
+ * \autor nvx
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define NVX_CRC32C_SSE42
+#endif
+
+#include "serialization.hpp"
+
+
+
+
+
+namespace nvx
+{
+
+
+
+
+
+/*!
+ * \addtogroup streams
+ *
+ * Сжимающие потоки стоят между архивом и потоком Stream:
+ * данные архива копируются в буфер блока, а Stream получает
+ * уже сжатые блоки целиком. Каждый блок сжимается независимо
+ * и записывается с заголовком:
+ *
+ * - uint32_t — размер несжатых данных блока;
+ * - uint32_t — размер данных блока в потоке;
+ * - uint8_t  — флаги (BLOCK_COMPRESSED, если блок сжат;
+ *   несжимаемые блоки хранятся как есть).
+ *
+ * Если установлен флаг BLOCK_CHECKSUM, за данными блока
+ * следует uint32_t — CRC32C заголовка и данных блока (в том
+ * виде, в каком они лежат в потоке), который проверяется при
+ * чтении до распаковки.
+ *
+ * Поэтому блоки можно пропускать, не распаковывая, и читать
+ * с произвольной позиции (см. block_istream::seekg). Числа
+ * заголовка, как и все данные архива, записываются в порядке
+ * байт машины
+ *
+ * @{
+ */
+
+/// Флаги заголовка блока
+enum BlockFlags
+{
+	BLOCK_COMPRESSED = 1 << 0,
+	BLOCK_CHECKSUM   = 1 << 1
+};
+
+/// Размер заголовка блока в байтах
+constexpr size_t BLOCK_HEADER_SIZE = 2 * sizeof(uint32_t) + 1;
+
+inline void _make_block_header(char *buf, uint32_t rawlen, uint32_t stored, uint8_t flags)
+{
+	std::memcpy(buf, &rawlen, sizeof rawlen);
+	std::memcpy(buf + sizeof rawlen, &stored, sizeof stored);
+	buf[2 * sizeof(uint32_t)] = flags;
+	return;
+}
+
+
+
+// Таблицы CRC32C (отражённый полином Кастаньоли) для
+// обработки восьми байт за шаг без аппаратной поддержки
+struct _crc32c_tables
+{
+	uint32_t t[8][256];
+
+	constexpr _crc32c_tables(): t()
+	{
+		for(uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t c = i;
+			for(int k = 0; k < 8; ++k)
+				c = c >> 1 ^ (c & 1 ? 0x82F63B78u : 0);
+			t[0][i] = c;
+		}
+
+		for(int k = 1; k < 8; ++k)
+			for(int i = 0; i < 256; ++i)
+				t[k][i] = t[k - 1][i] >> 8 ^ t[0][t[k - 1][i] & 0xFF];
+	}
+};
+
+inline constexpr _crc32c_tables _crc32c_lookup {};
+
+inline uint32_t _crc32c_soft(uint32_t crc, unsigned char const *p, size_t n)
+{
+	auto &t = _crc32c_lookup.t;
+
+	for(; n >= 8; n -= 8, p += 8)
+	{
+		uint32_t lo = crc ^ ( p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24 );
+		crc =
+			t[7][lo & 0xFF] ^ t[6][lo >> 8 & 0xFF] ^
+			t[5][lo >> 16 & 0xFF] ^ t[4][lo >> 24] ^
+			t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+	}
+
+	for(; n; --n, ++p)
+		crc = crc >> 8 ^ t[0][(crc ^ *p) & 0xFF];
+
+	return crc;
+}
+
+#ifdef NVX_CRC32C_SSE42
+__attribute__((target("sse4.2")))
+inline uint32_t _crc32c_sse42(uint32_t crc, unsigned char const *p, size_t n)
+{
+#ifdef __x86_64__
+	uint64_t c = crc;
+	for(; n >= 8; n -= 8, p += 8)
+	{
+		uint64_t v;
+		std::memcpy(&v, p, sizeof v);
+		c = _mm_crc32_u64(c, v);
+	}
+	crc = (uint32_t)c;
+#endif
+
+	for(; n; --n, ++p)
+		crc = _mm_crc32_u8(crc, *p);
+
+	return crc;
+}
+
+inline bool _has_sse42()
+{
+	static bool const has = [] {
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse4.2");
+	}();
+	return has;
+}
+#endif
+
+/// Контрольная сумма CRC32C n байт, начиная с data
+/*!
+ * Использует инструкцию crc32 из SSE4.2, если процессор её
+ * поддерживает, иначе — табличный алгоритм. Сумму длинных
+ * данных можно считать по частям, передавая в crc сумму
+ * предыдущих частей
+ */
+inline uint32_t crc32c(char const *data, size_t n, uint32_t crc = 0)
+{
+	unsigned char const *p = (unsigned char const *)data;
+
+#ifdef NVX_CRC32C_SSE42
+	if(_has_sse42())
+		return ~_crc32c_sse42(~crc, p, n);
+#endif
+
+	return ~_crc32c_soft(~crc, p, n);
+}
+
+
+
+/// Встроенный быстрый LZ-кодек
+/*!
+ * Кодек класса LZ77 с хеш-таблицей последовательностей из
+ * четырёх байт и окном в 64 КБ; последовательность — байт
+ * длин (литералов и совпадения), литералы, двухбайтовое
+ * смещение совпадения. Другие кодеки подключаются через
+ * параметр Codec потоков и должны предоставлять такие же
+ * статические функции:
+ *
+ * - bound(n) — наибольший размер сжатых n байт;
+ * - compress(src, n, dst) — сжатие в dst (размером не меньше
+ *   bound(n)), возвращает размер сжатых данных;
+ * - decompress(src, n, dst, rawlen) — распаковка ровно rawlen
+ *   байт; возвращает false, если данные повреждены
+ */
+struct lz_codec
+{
+	static size_t bound(size_t n)
+	{
+		return n + n / 255 + 16;
+	}
+
+	static size_t compress(char const *src, size_t n, char *dst)
+	{
+		uint32_t table[1 << HASH_BITS] = {};
+		size_t ip = 0, anchor = 0, op = 0;
+
+		// последние байты всегда уходят в литералы
+		if(n >= MIN_MATCH + 8)
+		{
+			size_t limit = n - MIN_MATCH;
+
+			while(ip < limit)
+			{
+				// в таблице хранятся позиции, увеличенные на 1 (0 — пусто)
+				uint32_t seq  = read32(src + ip);
+				uint32_t &pos = table[hash(seq)];
+				size_t cand   = pos - 1;
+				bool   found  = pos && ip - cand <= MAX_OFFSET && read32(src + cand) == seq;
+				pos = ip + 1;
+
+				if(!found)
+				{
+					++ip;
+					continue;
+				}
+
+				size_t len = MIN_MATCH;
+				while(ip + len < n && src[cand + len] == src[ip + len])
+					++len;
+
+				op = emit(dst, op, src + anchor, ip - anchor, ip - cand, len);
+				ip += len;
+				anchor = ip;
+			}
+		}
+
+		return emit(dst, op, src + anchor, n - anchor, 0, 0);
+	}
+
+	static bool decompress(char const *src, size_t n, char *dst, size_t rawlen)
+	{
+		unsigned char const *in = (unsigned char const *)src;
+		size_t ip = 0, op = 0;
+
+		while(ip < n)
+		{
+			unsigned token = in[ip++];
+
+			size_t lit = token >> 4;
+			if(lit == 15 && !extend(in, n, &ip, &lit))
+				return false;
+			if(lit > n - ip || lit > rawlen - op)
+				return false;
+
+			std::memcpy(dst + op, src + ip, lit);
+			ip += lit;
+			op += lit;
+
+			// последняя последовательность состоит из одних литералов
+			if(ip == n)
+			{
+				if(token & 15)
+					return false;
+				break;
+			}
+			if(n - ip < 2)
+				return false;
+
+			size_t offset = in[ip] | (size_t)in[ip + 1] << 8;
+			ip += 2;
+			if(!offset || offset > op)
+				return false;
+
+			size_t len = token & 15;
+			if(len == 15 && !extend(in, n, &ip, &len))
+				return false;
+			len += MIN_MATCH;
+			if(len > rawlen - op)
+				return false;
+
+			char *from = dst + op - offset;
+			if(offset >= len)
+				std::memcpy(dst + op, from, len);
+			else
+				for(size_t i = 0; i < len; ++i)
+					dst[op + i] = from[i];
+			op += len;
+		}
+
+		return op == rawlen;
+	}
+
+private:
+	static constexpr int    HASH_BITS  = 12;
+	static constexpr size_t MIN_MATCH  = 4;
+	static constexpr size_t MAX_OFFSET = 65535;
+
+	static uint32_t read32(char const *p)
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof v);
+		return v;
+	}
+
+	static uint32_t hash(uint32_t seq)
+	{
+		return (seq * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// Запись длины, не поместившейся в полубайт
+	static size_t put_length(char *dst, size_t op, size_t len)
+	{
+		for(; len >= 255; len -= 255)
+			dst[op++] = (char)255;
+		dst[op++] = (char)len;
+		return op;
+	}
+
+	static bool extend(unsigned char const *in, size_t n, size_t *ip, size_t *len)
+	{
+		unsigned b;
+		do
+		{
+			if(*ip >= n)
+				return false;
+			b = in[(*ip)++];
+			*len += b;
+		}
+		while(b == 255);
+		return true;
+	}
+
+	// Запись последовательности; matchlen == 0 — только литералы
+	static size_t emit(
+		char *dst, size_t op,
+		char const *lit, size_t litlen,
+		size_t offset, size_t matchlen
+	)
+	{
+		size_t ml = matchlen ? matchlen - MIN_MATCH : 0;
+		char &token = dst[op++];
+		token = (char)( std::min<size_t>(litlen, 15) << 4 | std::min<size_t>(ml, 15) );
+
+		if(litlen >= 15)
+			op = put_length(dst, op, litlen - 15);
+		std::memcpy(dst + op, lit, litlen);
+		op += litlen;
+
+		if(!matchlen)
+			return op;
+
+		dst[op++] = (char)(offset & 0xFF);
+		dst[op++] = (char)(offset >> 8);
+		if(ml >= 15)
+			op = put_length(dst, op, ml - 15);
+		return op;
+	}
+};
+
+
+
+/// Кодек без сжатия
+/*!
+ * Все блоки хранятся как есть (compress сообщает, что данные
+ * не сжались); нужен, чтобы разбивать данные на блоки только
+ * ради контрольных сумм
+ */
+struct null_codec
+{
+	static size_t bound(size_t)
+	{
+		return 0;
+	}
+
+	static size_t compress(char const *, size_t n, char *)
+	{
+		return n;
+	}
+
+	static bool decompress(char const *, size_t, char *, size_t)
+	{
+		return false;
+	}
+};
+
+
+
+/// Поток вывода, сжимающий данные блоками
+/*!
+ * Блок записывается в Stream, когда буфер заполнен, а также
+ * при вызове flush и в деструкторе. С флагом checksum к каждому
+ * блоку добавляется контрольная сумма CRC32C
+ */
+template<class Stream, class Codec = lz_codec>
+class block_ostream
+{
+public:
+	/// \param block — размер несжатого блока в байтах
+	/// \param checksum — записывать ли контрольные суммы блоков
+	explicit block_ostream(Stream *s, size_t block = 1 << 16, bool checksum = false):
+		s(s), raw(new char[block]), packed(new char[Codec::bound(block)]),
+		cap(block), checksum(checksum) {}
+
+	block_ostream(block_ostream const &) = delete;
+	block_ostream &operator=(block_ostream const &) = delete;
+
+	~block_ostream()
+	{
+		emit();
+	}
+
+
+
+	inline void write(char const *data, size_t n)
+	{
+		while(n)
+		{
+			size_t k = std::min(n, cap - len);
+			std::memcpy(raw.get() + len, data, k);
+			len  += k;
+			data += k;
+			n    -= k;
+
+			if(len == cap)
+				emit();
+		}
+
+		return;
+	}
+
+	/// Запись неполного блока и сброс Stream
+	inline void flush()
+	{
+		emit();
+		s->flush();
+		return;
+	}
+
+	inline operator bool() const
+	{
+		return ok && (bool)*s;
+	}
+
+	/// Число записанных (несжатых) байт
+	inline size_t tellp() const
+	{
+		return total + len;
+	}
+
+private:
+	void emit()
+	{
+		if(!len)
+			return;
+
+		size_t size = Codec::compress(raw.get(), len, packed.get());
+		uint8_t flags = BLOCK_COMPRESSED;
+		char const *data = packed.get();
+
+		if(size >= len)
+		{
+			size  = len;
+			flags = 0;
+			data  = raw.get();
+		}
+
+		if(checksum)
+			flags |= BLOCK_CHECKSUM;
+
+		char header[BLOCK_HEADER_SIZE];
+		_make_block_header(header, len, size, flags);
+
+		s->write(header, sizeof header);
+		s->write(data, size);
+		if(checksum)
+		{
+			uint32_t crc = crc32c(data, size, crc32c(header, sizeof header));
+			s->write((char const *)&crc, sizeof crc);
+		}
+		ok = ok && (bool)*s;
+
+		total += len;
+		len = 0;
+		return;
+	}
+
+	Stream *s;
+	std::unique_ptr<char[]> raw;
+	std::unique_ptr<char[]> packed;
+	size_t cap;
+	size_t len   = 0;
+	size_t total = 0;
+	bool   checksum;
+	bool   ok    = true;
+};
+
+
+
+/// Поток ввода, распаковывающий данные block_ostream
+/*!
+ * Если Stream умеет менять позицию чтения (seekg), то и этот
+ * поток умеет: переход к несжатой позиции pos пропускает
+ * заголовки предыдущих блоков, не распаковывая их.
+ *
+ * Блок с несовпавшей контрольной суммой делает поток
+ * неработоспособным, так что повреждённые данные не доходят
+ * до архива
+ */
+template<class Stream, class Codec = lz_codec>
+class block_istream
+{
+public:
+	/// \param maxblock — наибольший допустимый размер блока;
+	/// заголовки с большим размером считаются повреждёнными
+	/// \param checksum — требовать ли контрольную сумму у каждого
+	/// блока (иначе проверяются только имеющиеся)
+	explicit block_istream(Stream *s, size_t maxblock = 1 << 26, bool checksum = false):
+		s(s), maxblock(maxblock), checksum(checksum)
+	{
+		if constexpr(_has_seekg<Stream>::value)
+			base = s->tellg();
+	}
+
+	block_istream(block_istream const &) = delete;
+	block_istream &operator=(block_istream const &) = delete;
+
+
+
+	inline void read(char *data, size_t n)
+	{
+		while(n && !fail)
+		{
+			if(pos == len && !load())
+			{
+				fail = true;
+				break;
+			}
+
+			size_t k = std::min(n, len - pos);
+			std::memcpy(data, raw.get() + pos, k);
+			pos  += k;
+			data += k;
+			n    -= k;
+		}
+
+		return;
+	}
+
+	inline operator bool() const
+	{
+		return !fail;
+	}
+
+	/// Несжатая позиция чтения
+	inline size_t tellg() const
+	{
+		return start + pos;
+	}
+
+	/// Переход к несжатой позиции p (только если Stream умеет seekg)
+	template<class S = Stream, typename = std::enable_if_t<_has_seekg<S>::value>>
+	void seekg(size_t p)
+	{
+		// внутри текущего блока
+		if(p >= start && p < start + len)
+		{
+			pos = p - start;
+			return;
+		}
+
+		size_t at = base;
+		s->clear();
+		s->seekg(at);
+		start = len = pos = 0;
+		fail  = false;
+
+		for(;;)
+		{
+			uint32_t rawlen, stored;
+			uint8_t  flags;
+			if(!header(&rawlen, &stored, &flags))
+			{
+				fail = true;
+				return;
+			}
+
+			if(p < start + rawlen)
+			{
+				if(!unpack(rawlen, stored, flags))
+					fail = true;
+				pos = p - start;
+				return;
+			}
+
+			start += rawlen;
+			at    += BLOCK_HEADER_SIZE + stored;
+			if(flags & BLOCK_CHECKSUM)
+				at += sizeof(uint32_t);
+			s->seekg(at);
+		}
+	}
+
+	inline void clear()
+	{
+		fail = false;
+		return;
+	}
+
+private:
+	bool header(uint32_t *rawlen, uint32_t *stored, uint8_t *flags)
+	{
+		char buf[BLOCK_HEADER_SIZE];
+		s->read(buf, sizeof buf);
+		if(!*s)
+			return false;
+
+		std::memcpy(rawlen, buf, sizeof *rawlen);
+		std::memcpy(stored, buf + sizeof *rawlen, sizeof *stored);
+		*flags = buf[2 * sizeof(uint32_t)];
+
+		if(*flags & ~(BLOCK_COMPRESSED | BLOCK_CHECKSUM))
+			return false;
+		if(checksum && !(*flags & BLOCK_CHECKSUM))
+			return false;
+
+		return *rawlen && *rawlen <= maxblock &&
+			(*flags & BLOCK_COMPRESSED ? *stored <= Codec::bound(*rawlen) : *stored == *rawlen);
+	}
+
+	bool unpack(uint32_t rawlen, uint32_t stored, uint8_t flags)
+	{
+		if(rawlen > rawcap)
+		{
+			raw.reset(new char[rawlen]);
+			rawcap = rawlen;
+		}
+
+		len = 0;
+		pos = 0;
+
+		bool compressed = flags & BLOCK_COMPRESSED;
+		if(compressed && stored > packedcap)
+		{
+			packed.reset(new char[stored]);
+			packedcap = stored;
+		}
+
+		char *data = compressed ? packed.get() : raw.get();
+		s->read(data, stored);
+		if(!*s)
+			return false;
+
+		if(flags & BLOCK_CHECKSUM)
+		{
+			char header[BLOCK_HEADER_SIZE];
+			_make_block_header(header, rawlen, stored, flags);
+
+			uint32_t crc;
+			s->read((char *)&crc, sizeof crc);
+			if(!*s || crc != crc32c(data, stored, crc32c(header, sizeof header)))
+				return false;
+		}
+
+		if(compressed && !Codec::decompress(packed.get(), stored, raw.get(), rawlen))
+			return false;
+
+		len = rawlen;
+		return true;
+	}
+
+	bool load()
+	{
+		start += len;
+		len = pos = 0;
+
+		uint32_t rawlen, stored;
+		uint8_t  flags;
+		return header(&rawlen, &stored, &flags) && unpack(rawlen, stored, flags);
+	}
+
+	Stream *s;
+	size_t maxblock;
+	bool   checksum;
+	size_t base = 0;
+
+	std::unique_ptr<char[]> raw;
+	std::unique_ptr<char[]> packed;
+	size_t rawcap    = 0;
+	size_t packedcap = 0;
+
+	size_t start = 0; // несжатая позиция начала текущего блока
+	size_t len   = 0;
+	size_t pos   = 0;
+	bool   fail  = false;
+};
+
+/*! @} */
+
+
+
+
+
+}
+
+
+
+
+
+#endif // NVX_SERIALIZATION_BLOCK_HPP
@@ -0,0 +1,251 @@
+#ifndef NVX_SERIALIZATION_MMAP_HPP
+#define NVX_SERIALIZATION_MMAP_HPP
+
+/**
+ * \file Потоки для (де)сериализации через отображение
+ * файлов в память (только для POSIX-систем)
+ * \autor nvx
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "serialization.hpp"
+
+
+
+
+
+namespace nvx
+{
+
+
+
+
+
+/*!
+ * \addtogroup streams
+ *
+ * Файл отображается в память целиком, поэтому вместо
+ * системного вызова на каждое прочитанное значение
+ * (как у ifstream) данные подгружаются постранично
+ *
+ * @{
+ */
+
+/// Поток чтения из файла, отображённого в память
+/*!
+ * Работает так же, как memory_istream над содержимым файла
+ * (в том числе без копирования отдаёт данные через take,
+ * так что к нему применимы string_view и span); ядру
+ * сообщается, что файл будет читаться последовательно.
+ * Если файл не удалось открыть, поток сразу неработоспособен
+ */
+class mmap_istream: public memory_istream
+{
+public:
+	explicit mmap_istream(std::string const &filename):
+		memory_istream(nullptr, 0)
+	{
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if(fd < 0)
+			return;
+
+		struct stat st;
+		if(::fstat(fd, &st) == 0)
+		{
+			len = st.st_size;
+			ok  = !len;
+
+			void *p = len ?
+				::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+			if(p != MAP_FAILED)
+			{
+				::madvise(p, len, MADV_SEQUENTIAL);
+				memory_istream::operator=( memory_istream((char const *)p, len) );
+				addr = p;
+				ok   = true;
+			}
+		}
+
+		::close(fd);
+	}
+
+	mmap_istream(mmap_istream const &) = delete;
+	mmap_istream &operator=(mmap_istream const &) = delete;
+
+	~mmap_istream()
+	{
+		if(addr)
+			::munmap(addr, len);
+	}
+
+
+
+	inline operator bool() const
+	{
+		return ok && memory_istream::operator bool();
+	}
+
+	/// Удалось ли открыть и отобразить файл
+	inline bool is_open() const
+	{
+		return ok;
+	}
+
+	/// Размер файла
+	inline size_t size() const
+	{
+		return len;
+	}
+
+private:
+	void  *addr = nullptr;
+	size_t len  = 0;
+	bool   ok   = false;
+};
+
+
+
+/// Поток записи в файл, отображённый в память
+/*!
+ * Файл создаётся (или обрезается) при открытии и растёт
+ * вдвое через ftruncate с повторным отображением, когда
+ * данные перестают помещаться; при закрытии обрезается до
+ * числа записанных байт
+ */
+class mmap_ostream
+{
+public:
+	/// \param capacity — начальный размер отображения в байтах
+	explicit mmap_ostream(std::string const &filename, size_t capacity = 1 << 20)
+	{
+		fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		ok = fd >= 0 && reserve(std::max<size_t>(capacity, 1));
+	}
+
+	mmap_ostream(mmap_ostream const &) = delete;
+	mmap_ostream &operator=(mmap_ostream const &) = delete;
+
+	~mmap_ostream()
+	{
+		close();
+	}
+
+
+
+	inline void write(char const *data, size_t n)
+	{
+		if(!ok)
+			return;
+
+		if(n > cap - len && !reserve(len + n))
+		{
+			ok = false;
+			return;
+		}
+
+		std::memcpy(addr + len, data, n);
+		len += n;
+		return;
+	}
+
+	/// Асинхронный сброс записанных страниц на диск
+	inline void flush()
+	{
+		if(addr)
+			::msync(addr, cap, MS_ASYNC);
+		return;
+	}
+
+	inline operator bool() const
+	{
+		return ok;
+	}
+
+	/// Число записанных байт
+	inline size_t tellp() const
+	{
+		return len;
+	}
+
+	inline bool is_open() const
+	{
+		return fd >= 0;
+	}
+
+	/// Снятие отображения и обрезка файла до записанных данных
+	void close()
+	{
+		if(fd < 0)
+			return;
+
+		if(addr)
+			::munmap(addr, cap);
+		if(::ftruncate(fd, len) != 0)
+			ok = false;
+		::close(fd);
+
+		fd   = -1;
+		addr = nullptr;
+		cap  = 0;
+		return;
+	}
+
+private:
+	bool reserve(size_t need)
+	{
+		size_t page = ::sysconf(_SC_PAGESIZE);
+		size_t ncap = std::max(need, 2 * cap);
+		ncap = (ncap + page - 1) / page * page;
+
+		if(::ftruncate(fd, ncap) != 0)
+			return false;
+
+		void *p;
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+		p = addr ?
+			::mremap(addr, cap, ncap, MREMAP_MAYMOVE) :
+			::mmap(nullptr, ncap, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+#else
+		if(addr)
+			::munmap(addr, cap);
+		addr = nullptr;
+		p = ::mmap(nullptr, ncap, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+#endif
+
+		// при неудаче mremap прежнее отображение остаётся в силе
+		if(p == MAP_FAILED)
+			return false;
+
+		addr = (char *)p;
+		cap  = ncap;
+		return true;
+	}
+
+	int    fd   = -1;
+	char  *addr = nullptr;
+	size_t cap  = 0;
+	size_t len  = 0;
+	bool   ok   = false;
+};
+
+/*! @} */
+
+
+
+
+
+}
+
+
+
+
+
+#endif // NVX_SERIALIZATION_MMAP_HPP
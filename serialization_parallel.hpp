@@ -0,0 +1,389 @@
+#ifndef NVX_SERIALIZATION_PARALLEL_HPP
+#define NVX_SERIALIZATION_PARALLEL_HPP
+
+/**
+ * \file Параллельная (де)сериализация больших контейнеров
+ * \autor nvx
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "serialization.hpp"
+
+
+
+
+
+namespace nvx
+{
+
+
+
+
+
+/*!
+ * \defgroup parallel Параллельная сериализация
+ *
+ * Элементы контейнера делятся на части, которые потоки
+ * выполнения разбирают по одной через общий счётчик: поток,
+ * закончивший свою часть раньше, сразу берёт следующую, так
+ * что элементы разного размера распределяются между ядрами
+ * сами собой
+ *
+ * @{
+ */
+
+// Выполнение work(i) для всех частей i < count в threads
+// потоках (включая вызывающий); первое исключение
+// пробрасывается вызывающему после завершения потоков
+template<class F>
+void _parallel_for(size_t count, unsigned threads, F const &work)
+{
+	std::atomic<size_t> next { 0 };
+	std::exception_ptr  error;
+	std::mutex          m;
+
+	auto run = [&] {
+		try
+		{
+			for(size_t i; (i = next++) < count; )
+				work(i);
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(m);
+			if(!error)
+				error = std::current_exception();
+			next = count;
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for(unsigned t = 1; t < std::min<size_t>(threads, count); ++t)
+		pool.emplace_back(run);
+	run();
+
+	for(auto &t : pool)
+		t.join();
+	if(error)
+		std::rethrow_exception(error);
+	return;
+}
+
+
+
+// Запись частей вектора по chunk элементов в отдельные
+// буферы parts; false, если архивы частей выдали кому-то
+// идентификаторы и результат придётся отбросить
+template<class Ostream, typename Meta, int Mode, typename T, class Alloc>
+bool _serialize_parts(
+	archive<Ostream, Meta, Mode> &os,
+	std::vector<T, Alloc> const *cont,
+	unsigned threads,
+	size_t chunk,
+	std::vector<std::string> *parts
+)
+{
+	size_t size = cont->size();
+	parts->assign((size + chunk - 1) / chunk, std::string());
+
+	std::atomic<bool> tracked { false };
+
+	_parallel_for(parts->size(), threads, [&](size_t i) {
+		if(tracked)
+			return;
+
+		buffer_ostream buf(&(*parts)[i]);
+		archive<buffer_ostream, Meta, Mode> arch(&buf, os.get_mode());
+
+		T const *b = cont->data() + i * chunk;
+		T const *e = cont->data() + std::min(size, (i + 1) * chunk);
+		for(; b != e; ++b)
+			serialize(arch, b);
+
+		if(arch.tracked())
+			tracked = true;
+	});
+
+	return !tracked;
+}
+
+// Можно ли в режиме архива a записывать элементы T по частям
+template<typename T, class Stream, typename Meta, int Mode>
+bool _parts_enabled(archive<Stream, Meta, Mode> const &a)
+{
+	return !_bulk_enabled<T>(a) &&
+		!(a.get_mode() & (iterative_mode | aligned_mode));
+}
+
+inline unsigned _parallel_threads(unsigned threads)
+{
+	return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+
+/// Параллельная сериализация вектора
+/*!
+ * Каждая часть записывается отдельным архивом (в том же
+ * режиме, что и os) в свой буфер, после чего буферы по
+ * порядку передаются потоку os, поэтому результат совпадает
+ * с serialize(os, cont) и читается обычной десериализацией
+ * (в режиме chunked_mode части совпадают с частями
+ * контейнера). Пока части не записаны, все они хранятся в
+ * памяти.
+ *
+ * Элементы не должны ссылаться через указатели на объекты,
+ * которые архив уже встречал: если при записи частей
+ * кому-то выдан идентификатор (determine_pointers_mode,
+ * determine_shared_mode), результат отбрасывается и вектор
+ * записывается последовательно. Последовательно записываются
+ * и вектора элементов, копируемых одним блоком, и вектора,
+ * не набравшие двух частей, и любые вектора в режимах
+ * iterative_mode и aligned_mode. Архив os не должен быть
+ * подключён к Лире
+ *
+ * \param threads — число потоков (0 — по числу ядер)
+ * \param chunk — число элементов в части (не учитывается
+ *        в режиме chunked_mode)
+ *
+ * \return Число записанных байт
+ */
+template<class Ostream, typename Meta, int Mode, typename T, class Alloc>
+int serialize_parallel(
+	archive<Ostream, Meta, Mode> &os,
+	std::vector<T, Alloc> const *cont,
+	unsigned threads = 0,
+	size_t chunk = CHUNK_ELEMENTS
+)
+{
+	int    mode = os.get_mode();
+	size_t size = cont->size();
+
+	threads = _parallel_threads(threads);
+	if(mode & chunked_mode || !chunk)
+		chunk = CHUNK_ELEMENTS;
+
+	std::vector<std::string> parts;
+	if(
+		threads < 2 || size <= chunk || !_parts_enabled<T>(os) ||
+		!_serialize_parts(os, cont, threads, chunk, &parts)
+	)
+		return serialize(os, cont);
+
+	int res = 0;
+	if(!(mode & chunked_mode))
+	{
+		int32_t n = size;
+		if( !(res = serialize(os, &n)) )
+			return 0;
+	}
+
+	for(size_t i = 0; i < parts.size(); ++i)
+	{
+		if(mode & chunked_mode)
+		{
+			int32_t n = std::min(size - i * chunk, chunk);
+			res += serialize(os, &n);
+		}
+
+		if(!parts[i].empty() && !_serialize_range(os, parts[i].data(), parts[i].size(), true))
+			return 0;
+		res += parts[i].size();
+		std::string().swap(parts[i]);
+	}
+
+	if(mode & chunked_mode)
+	{
+		int32_t end = 0;
+		res += serialize(os, &end);
+	}
+
+	return res;
+}
+
+
+
+/// Параллельная сериализация вектора с таблицей смещений частей
+/*!
+ * Части записываются так же, как в serialize_parallel, но
+ * перед ними вместо размера записывается заголовок с длинами
+ * всех частей, чтобы deserialize_parallel могла разбирать
+ * их одновременно. Обычная десериализация такой вектор тоже
+ * читает (заголовок просто пропускается).
+ *
+ * Если вектор нельзя записать по частям (см. serialize_parallel),
+ * а также в режиме chunked_mode, он записывается обычным
+ * образом
+ *
+ * \param threads — число потоков (0 — по числу ядер)
+ * \param chunk — число элементов в части
+ *
+ * \return Число записанных байт
+ */
+template<class Ostream, typename Meta, int Mode, typename T, class Alloc>
+int serialize_indexed(
+	archive<Ostream, Meta, Mode> &os,
+	std::vector<T, Alloc> const *cont,
+	unsigned threads = 0,
+	size_t chunk = CHUNK_ELEMENTS
+)
+{
+	threads = _parallel_threads(threads);
+	chunk = std::min<size_t>(chunk ? chunk : CHUNK_ELEMENTS, std::numeric_limits<int32_t>::max());
+
+	std::vector<std::string> parts;
+	if(
+		(os.get_mode() & chunked_mode) || !_parts_enabled<T>(os) ||
+		!_serialize_parts(os, cont, threads, chunk, &parts)
+	)
+		return serialize(os, cont);
+
+	std::vector<ullong> lengths;
+	for(auto &part : parts)
+		lengths.push_back(part.size());
+
+	int res = _serialize_index(os, cont->size(), chunk, lengths);
+	for(auto &part : parts)
+	{
+		if(!part.empty() && !_serialize_range(os, part.data(), part.size(), true))
+			return 0;
+		res += part.size();
+		std::string().swap(part);
+	}
+
+	return res;
+}
+
+
+
+/// Параллельная десериализация вектора
+/*!
+ * Вектор, записанный serialize_indexed, сразу получает
+ * итоговый размер, и его части разбираются одновременно
+ * прямо в свои элементы; любой другой вектор читается
+ * последовательно, как обычной десериализацией.
+ *
+ * Части разбираются отдельными архивами в режиме is, без
+ * арены и ресурса памяти, поэтому если они подключены к is,
+ * вектор тоже читается последовательно. Данные всех частей
+ * берутся из потока одним куском (из memory_istream — без
+ * копирования)
+ *
+ * \param threads — число потоков (0 — по числу ядер)
+ *
+ * \return Число считанных байт
+ */
+template<class Istream, typename Meta, int Mode, typename T, class Alloc>
+int deserialize_parallel(
+	archive<Istream, Meta, Mode> &is,
+	std::vector<T, Alloc> *cont,
+	unsigned threads = 0
+)
+{
+	int mode = is.get_mode();
+
+	if(
+		(mode & chunked_mode) || !_parts_enabled<T>(is) ||
+		is.get_arena() || is.get_memory_resource()
+	)
+		return deserialize(is, cont);
+
+	int32_t size;
+	int res = deserialize(is, &size);
+	if(!res)
+		return 0;
+
+	if(size != INDEXED_MARK)
+	{
+		if(size < 0)
+			return 0;
+		return res + _deserialize_contiguous(is, cont, size);
+	}
+
+	int32_t chunk;
+	std::vector<ullong> lengths;
+	int n = _deserialize_index(is, &size, &chunk, &lengths);
+	if(!n)
+		return 0;
+	res += n;
+
+	/*
+	 * Длины частей берутся из потока, поэтому их сумма вместе
+	 * с заголовком должна умещаться в возвращаемое значение
+	 */
+	std::vector<size_t> offsets;
+	size_t total = 0;
+	for(ullong len : lengths)
+	{
+		if(len > (ullong)(std::numeric_limits<int>::max() - res) - total)
+			return 0;
+		offsets.push_back(total);
+		total += len;
+	}
+
+	// каждый элемент, кроме пустых структур, занимает хотя бы
+	// байт, так что размер вектора не превышает длины частей
+	if(_fixed_size<T>::value != 0 && (size_t)size > total)
+		return 0;
+
+	char const *data;
+	std::string copy;
+	if constexpr(_has_take<Istream>::value)
+	{
+		if( !(data = _take(is, total)) )
+			return 0;
+	}
+	else
+	{
+		// буфер растёт по мере чтения, чтобы заголовок
+		// обрезанного потока не заставил выделить всё сразу
+		for(size_t done = 0, step; done < total; done += step)
+		{
+			step = std::min<size_t>(total - done, 1 << 20);
+			copy.resize(done + step);
+			if(!_deserialize_range(is, &copy[done], step))
+				return 0;
+		}
+		data = copy.data();
+	}
+
+	cont->clear();
+	cont->resize(size);
+
+	std::atomic<bool> failed { false };
+	_parallel_for(lengths.size(), _parallel_threads(threads), [&](size_t i) {
+		memory_istream ms(data + offsets[i], lengths[i]);
+		archive<memory_istream, Meta, Mode> arch(&ms, mode);
+
+		T *b = cont->data() + i * chunk;
+		T *e = cont->data() + std::min<size_t>(size, (i + 1) * chunk);
+		for(; b != e && ms; ++b)
+			deserialize(arch, b);
+
+		if(!ms || ms.remaining())
+			failed = true;
+	});
+
+	return failed ? 0 : res + (int)total;
+}
+
+/*! @} */
+
+
+
+
+
+}
+
+
+
+
+
+#endif // NVX_SERIALIZATION_PARALLEL_HPP
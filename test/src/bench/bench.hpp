@@ -0,0 +1,144 @@
+#ifndef BENCH_HARNESS_5520417
+#define BENCH_HARNESS_5520417
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <serialization.hpp>
+
+
+
+
+
+/*
+ * Замер одной операции: после прогрева fn выполняется,
+ * пока не наберётся min_time секунд (и не меньше пяти раз);
+ * сохраняются времена всех выполнений
+ */
+struct measurement
+{
+	double total  = 0;
+	double median = 0;
+	double p99    = 0;
+	size_t iterations = 0;
+};
+
+template<class F>
+measurement measure(F const &fn, double min_time)
+{
+	typedef std::chrono::steady_clock clock;
+
+	fn();
+
+	std::vector<double> times;
+	double total = 0;
+	while((total < min_time || times.size() < 5) && times.size() < 100000)
+	{
+		auto start = clock::now();
+		fn();
+		double t = std::chrono::duration<double>(clock::now() - start).count();
+		times.push_back(t);
+		total += t;
+	}
+
+	std::sort(times.begin(), times.end());
+
+	measurement m;
+	m.total      = total;
+	m.iterations = times.size();
+	m.median     = times[times.size() / 2];
+	m.p99        = times[std::min(times.size() - 1, times.size() * 99 / 100)];
+	return m;
+}
+
+
+
+// Скорость копирования bytes байт через memcpy (МБ/с) —
+// верхняя граница для (де)сериализации тех же данных
+inline double memcpy_bandwidth(size_t bytes, double min_time)
+{
+	static std::map<size_t, double> cache;
+
+	auto it = cache.find(bytes);
+	if(it != cache.end())
+		return it->second;
+
+	std::vector<char> src(bytes, 1), dst(bytes);
+	measurement m = measure([&] {
+		std::memcpy(dst.data(), src.data(), bytes);
+		asm volatile("" : : "r"(dst.data()) : "memory");
+	}, min_time);
+
+	return cache[bytes] = bytes / m.median / 1e6;
+}
+
+
+
+// Имя режима архива вида "determine_shared|varint"
+inline std::string mode_name(int mode)
+{
+	static std::pair<int, char const *> const names[] = {
+		{ nvx::determine_pointers_mode, "determine_pointers" },
+		{ nvx::determine_shared_mode,   "determine_shared"   },
+		{ nvx::varint_mode,             "varint"             },
+		{ nvx::delta_mode,              "delta"              },
+		{ nvx::hash_geometry_mode,      "hash_geometry"      },
+		{ nvx::iterative_mode,          "iterative"          },
+		{ nvx::chunked_mode,            "chunked"            },
+		{ nvx::aligned_mode,            "aligned"            },
+		{ nvx::little_endian_mode,      "little_endian"      },
+		{ nvx::big_endian_mode,         "big_endian"         }
+	};
+
+	std::string res;
+	for(auto &n : names)
+	{
+		if(mode & n.first)
+			res += (res.empty() ? "" : "|") + std::string(n.second);
+	}
+	return res.empty() ? "none" : res;
+}
+
+
+
+// Результаты выводятся в stdout в формате CSV
+inline void report_header()
+{
+	std::printf(
+		"category,mode,direction,bytes,objects,iterations,"
+		"median_us,p99_us,mb_per_s,objects_per_s,memcpy_mb_per_s,memcpy_ratio\n"
+	);
+	return;
+}
+
+inline void report(
+	char const *category,
+	int mode,
+	char const *direction,
+	size_t bytes,
+	size_t objects,
+	measurement const &m,
+	double memcpy_mbs
+)
+{
+	double mbs = bytes / m.median / 1e6;
+
+	std::printf(
+		"%s,%s,%s,%zu,%zu,%zu,%.3f,%.3f,%.1f,%.0f,%.1f,%.4f\n",
+		category, mode_name(mode).c_str(), direction, bytes, objects, m.iterations,
+		m.median * 1e6, m.p99 * 1e6, mbs, objects / m.median, memcpy_mbs, mbs / memcpy_mbs
+	);
+	std::fflush(stdout);
+	return;
+}
+
+
+
+
+
+#endif
@@ -0,0 +1,340 @@
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <serialization.hpp>
+
+#include "bench.hpp"
+
+
+using namespace nvx;
+using namespace std;
+
+
+
+
+
+/************************** STRUCTS *************************/
+struct Point
+{
+	double x, y;
+	int    tag;
+
+	NVX_SERIALIZABLE_PLAIN();
+};
+
+struct Containers
+{
+	map<int, int>               ordered;
+	unordered_map<int, double>  hashed;
+	set<long long>              keys;
+	list<int>                   sequence;
+	vector<vector<int>>         nested;
+
+	NVX_SERIALIZABLE(&ordered, &hashed, &keys, &sequence, &nested);
+};
+
+struct Record
+{
+	int              id;
+	string           name;
+	vector<double>   values;
+	map<int, string> tags;
+
+	NVX_SERIALIZABLE(&id, &name, &values, &tags);
+};
+
+struct GraphNode
+{
+	int                 val = 0;
+	vector<GraphNode *> edges;
+
+	NVX_SERIALIZABLE(&val, &edges);
+};
+
+
+
+
+
+/************************** HARNESS *************************/
+static mt19937 gen(20240);
+static double  min_time = 0.05;
+static char const *filter = "";
+
+static int rand_int(int min, int max)
+{
+	return uniform_int_distribution<int>(min, max)(gen);
+}
+
+static string rand_string(int maxlen)
+{
+	string s(rand_int(0, maxlen), ' ');
+	for (auto &c : s)
+		c = (char)rand_int('a', 'z');
+	return s;
+}
+
+// Флаги, которые по очереди добавляются к основному режиму
+static int const flags[] = {
+	0,
+	varint_mode,
+	delta_mode,
+	hash_geometry_mode,
+	iterative_mode,
+	chunked_mode,
+	aligned_mode,
+	little_endian_mode,
+	big_endian_mode
+};
+
+/*
+ * Замер записи (write) и чтения (read) для каждого режима;
+ * write(arch) пишет данные в архив, read(arch) читает их
+ * обратно и освобождает всё, что было создано при чтении
+ */
+template<class Write, class Read>
+static void run(char const *category, int base, size_t objects, Write const &write, Read const &read)
+{
+	for (int flag : flags)
+	{
+		int mode = base | flag;
+
+		string name = string(category) + "/" + mode_name(mode);
+		if (!strstr(name.c_str(), filter))
+			continue;
+
+		string buf;
+		buffer_ostream out(&buf);
+		measurement w = measure([&] {
+			out.clear();
+			archive<buffer_ostream> arch(&out, mode);
+			write(arch);
+		}, min_time);
+
+		measurement r = measure([&] {
+			memory_istream in(buf.data(), buf.size());
+			archive<memory_istream> arch(&in, mode);
+			read(arch);
+		}, min_time);
+
+		double bound = memcpy_bandwidth(buf.size(), min_time);
+		report(category, mode, "write", buf.size(), objects, w, bound);
+		report(category, mode, "read",  buf.size(), objects, r, bound);
+	}
+}
+
+
+
+
+
+/************************** CASES ***************************/
+static void primitive_types()
+{
+	size_t const n = 1 << 16;
+	vector<long long> ints(n), intsr(n);
+	vector<double>    dbls(n), dblsr(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		ints[i] = rand_int(-1000000, 1000000);
+		dbls[i] = rand_int(0, 1 << 30) / 7.0;
+	}
+
+	run("primitive_types", none_mode, 2 * n,
+		[&](auto &arch) {
+			for (size_t i = 0; i < n; ++i)
+				arch << &ints[i] << &dbls[i];
+		},
+		[&](auto &arch) {
+			for (size_t i = 0; i < n; ++i)
+				arch >> &intsr[i] >> &dblsr[i];
+		}
+	);
+}
+
+static void pointers_to_primitive_types()
+{
+	size_t const n = 1 << 14;
+	vector<int *> ptrs(n);
+	for (auto &p : ptrs)
+		p = new int(rand_int(0, 1000));
+
+	run("pointers_to_primitive_types", determine_pointers_mode, n,
+		[&](auto &arch) { arch << &ptrs; },
+		[&](auto &arch) {
+			vector<int *> res;
+			arch >> &res;
+			for (int *p : res)
+				delete p;
+		}
+	);
+
+	for (int *p : ptrs)
+		delete p;
+}
+
+static void arrays_and_plain()
+{
+	int const n = 1 << 18;
+	double *arr = new double[n];
+	for (int i = 0; i < n; ++i)
+		arr[i] = i * 0.25;
+
+	vector<Point> points(1 << 15);
+	for (auto &p : points)
+		p = { rand_int(0, 100) / 3.0, rand_int(0, 100) / 7.0, rand_int(0, 100) };
+
+	run("arrays_and_plain", none_mode, n + points.size(),
+		[&](auto &arch) {
+			serialize_array(arch, &arr, &n);
+			arch << &points;
+		},
+		[&](auto &arch) {
+			double *res = nullptr;
+			int size;
+			vector<Point> pointsr;
+			deserialize_array(arch, &res, &size);
+			arch >> &pointsr;
+			delete[] res;
+		}
+	);
+
+	delete[] arr;
+}
+
+static void std_containers()
+{
+	Containers c;
+	for (int i = 0; i < 1 << 14; ++i)
+	{
+		c.ordered[i * 3] = rand_int(0, 1000);
+		c.hashed[rand_int(0, 1 << 30)] = i;
+		c.keys.insert(i * 7LL);
+		c.sequence.push_back(i);
+	}
+	c.nested.resize(1 << 10);
+	for (auto &v : c.nested)
+		v.assign(rand_int(0, 32), 5);
+
+	size_t objects = c.ordered.size() + c.hashed.size() + c.keys.size() +
+		c.sequence.size() + c.nested.size();
+
+	run("std_containers", none_mode, objects,
+		[&](auto &arch) { arch << &c; },
+		[&](auto &arch) { Containers res; arch >> &res; }
+	);
+}
+
+static void strings()
+{
+	vector<string> strs(1 << 15);
+	for (auto &s : strs)
+		s = rand_string(64);
+
+	run("strings", none_mode, strs.size(),
+		[&](auto &arch) { arch << &strs; },
+		[&](auto &arch) { vector<string> res; arch >> &res; }
+	);
+}
+
+static void user_structs()
+{
+	vector<Record> records(1 << 13);
+	for (auto &r : records)
+	{
+		r.id   = rand_int(0, 1 << 30);
+		r.name = rand_string(24);
+		r.values.assign(rand_int(0, 16), 1.5);
+		for (int i = rand_int(0, 3); i; --i)
+			r.tags[rand_int(0, 100)] = rand_string(8);
+	}
+
+	run("user_structs", none_mode, records.size(),
+		[&](auto &arch) { arch << &records; },
+		[&](auto &arch) { vector<Record> res; arch >> &res; }
+	);
+}
+
+static void shared_pointers()
+{
+	vector<shared_ptr<Record>> ptrs(1 << 13);
+	for (size_t i = 0; i < ptrs.size(); ++i)
+	{
+		// каждый второй указатель ссылается на уже встреченный объект
+		if (i && rand_int(0, 1))
+			ptrs[i] = ptrs[rand_int(0, i - 1)];
+		else
+			ptrs[i] = make_shared<Record>(Record{ (int)i, rand_string(16), {}, {} });
+	}
+
+	run("shared_pointers", determine_shared_mode, ptrs.size(),
+		[&](auto &arch) { arch << &ptrs; },
+		[&](auto &arch) { vector<shared_ptr<Record>> res; arch >> &res; }
+	);
+}
+
+static void circular_graphs()
+{
+	vector<GraphNode *> nodes(1 << 13);
+	for (auto &node : nodes)
+		node = new GraphNode;
+
+	/*
+	 * Узлы объединены в кольца по восемь, плюс случайные рёбра
+	 * к предыдущим узлам (чтобы глубина рекурсии при записи
+	 * оставалась небольшой)
+	 */
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		nodes[i]->val = i;
+		nodes[i]->edges.push_back(nodes[i / 8 * 8 + (i + 1) % 8]);
+		for (int k = i ? rand_int(0, 3) : 0; k; --k)
+			nodes[i]->edges.push_back(nodes[rand_int(0, i - 1)]);
+	}
+
+	run("circular_graphs", determine_pointers_mode, nodes.size(),
+		[&](auto &arch) { arch << &nodes; },
+		[&](auto &arch) {
+			vector<GraphNode *> res;
+			arch >> &res;
+			for (GraphNode *node : res)
+				delete node;
+		}
+	);
+
+	for (GraphNode *node : nodes)
+		delete node;
+}
+
+
+
+
+
+/*************************** MAIN ***************************/
+// benchmark [фильтр "категория/режим"] [секунд на замер]
+int main( int argc, char *argv[] )
+{
+	if (argc > 1)
+		filter = argv[1];
+	if (argc > 2)
+		min_time = atof(argv[2]);
+
+	report_header();
+
+	primitive_types();
+	pointers_to_primitive_types();
+	arrays_and_plain();
+	std_containers();
+	strings();
+	user_structs();
+	shared_pointers();
+	circular_graphs();
+
+	return 0;
+}
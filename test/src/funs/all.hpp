@@ -6,14 +6,38 @@
 
 
 bool primitive_types();
+bool varint_primitive_types();
 bool pointers_to_primitive_types();
 bool arrays_and_plain();
 bool std_containers();
+bool delta_containers();
+bool ordered_containers();
+bool unordered_geometry();
+bool pmr_containers();
+bool chunked_containers();
 bool strings();
+bool string_serialization();
 bool user_structs();
+bool serialized_sizes();
 bool pointers();
+bool arena_pointers();
+bool iterative_pointers();
+bool pointer_tables();
 bool shared_pointers_simple();
 bool circle_shared_pointers();
+bool buffer_streams();
+bool memory_streams();
+bool memory_views();
+bool mmap_streams();
+bool async_streams();
+bool block_streams();
+bool block_checksums();
+bool bulk_containers();
+bool endian_modes();
+bool parallel_serialization();
+bool indexed_serialization();
+bool archive_statistics();
+bool static_modes();
 
 
 
@@ -0,0 +1,275 @@
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <nvx/iostream.hpp>
+#include <nvx/type.hpp>
+
+#include <assert.hpp>
+#include <random_value.hpp>
+
+#include <serialization.hpp>
+
+
+using namespace nvx;
+using namespace std;
+
+
+
+
+
+/************************** STRUCTS *************************/
+struct Point
+{
+	double x, y;
+	int    tag;
+
+	bool operator==(Point const &rhs) const
+	{
+		return x == rhs.x && y == rhs.y && tag == rhs.tag;
+	}
+
+	NVX_SERIALIZABLE_PLAIN();
+};
+
+struct HookedPoint
+{
+	int x, y;
+
+	static int deserialized;
+
+	void after_deserialization() const
+	{
+		++deserialized;
+	}
+
+	bool operator==(HookedPoint const &rhs) const
+	{
+		return x == rhs.x && y == rhs.y;
+	}
+
+	NVX_SERIALIZABLE_PLAIN();
+};
+
+int HookedPoint::deserialized = 0;
+
+// наследник плоской структуры со строкой плоским не является
+struct LabeledPoint: Point
+{
+	string label;
+
+	bool operator==(LabeledPoint const &rhs) const
+	{
+		return Point::operator==(rhs) && label == rhs.label;
+	}
+
+	NVX_SERIALIZABLE(&x, &y, &tag, &label);
+};
+
+static_assert(is_bulk_serializable<Point>::value);
+static_assert(!is_bulk_serializable<HookedPoint>::value);
+static_assert(!is_bulk_serializable<LabeledPoint>::value);
+
+template<class Ostream>
+inline Ostream &operator<<(Ostream &os, Point const &toprint)
+{
+	return os;
+}
+
+template<class Ostream>
+inline Ostream &operator<<(Ostream &os, HookedPoint const &toprint)
+{
+	return os;
+}
+
+template<class Ostream>
+inline Ostream &operator<<(Ostream &os, LabeledPoint const &toprint)
+{
+	return os;
+}
+
+
+
+
+
+/************************* FUNCTION *************************/
+bool bulk_containers()
+{
+	for (int _ = 0; _ < 100; ++_)
+	{
+		vector<int>         ints    = random_value<vector<int>>(),    intsr,    intsm;
+		vector<double>      dbls    = random_value<vector<double>>(), dblsr,    dblsm;
+		string              str     = random_value<string>(),         strr;
+		vector<Point>       points(rnd(0, 50)),                       pointsr,  pointsm;
+		vector<HookedPoint> hooked(rnd(1, 50)),                       hookedr;
+		vector<LabeledPoint> labeled(rnd(0, 20)),                     labeledr;
+
+		for (auto &p : points)
+			p = { random_value<double>(), random_value<double>(), random_value<int>() };
+		for (auto &p : hooked)
+			p = { random_value<int>(), random_value<int>() };
+		for (auto &p : labeled)
+		{
+			p.x = random_value<double>();
+			p.y = random_value<double>();
+			p.tag = random_value<int>();
+			p.label = random_value<string>();
+		}
+
+		stringstream ss;
+		archive(&ss) << &ints << &dbls << &str << &points << &hooked << &labeled;
+		string src = ss.str();
+
+		HookedPoint::deserialized = 0;
+		archive(&ss) >> &intsr >> &dblsr >> &strr >> &pointsr >> &hookedr >> &labeledr;
+
+		// shift by one byte so that the elements are misaligned
+		string shifted = " " + src;
+		memory_istream ms(shifted.data() + 1, src.size());
+		archive(&ms) >> &intsm >> &dblsm;
+
+		// element-wise layout: size followed by the elements
+		string expected;
+		int32_t size = ints.size();
+		expected.append((char const *)&size, sizeof size);
+		for (int i : ints)
+			expected.append((char const *)&i, sizeof i);
+
+		try
+		{
+			assert_eq(ints,   intsr,   "ints != intsr");
+			assert_eq(dbls,   dblsr,   "dbls != dblsr");
+			assert_eq(str,    strr,    "str != strr");
+			assert_eq(points, pointsr, "points != pointsr");
+			assert_eq(hooked, hookedr, "hooked != hookedr");
+			assert_eq(labeled == labeledr, true, "labeled != labeledr");
+			assert_eq(ints,   intsm,   "ints != intsm");
+			assert_eq(dbls,   dblsm,   "dbls != dblsm");
+			assert_eq(HookedPoint::deserialized, (int)hooked.size(), "hooks were not called");
+			assert_eq(src.substr(0, expected.size()), expected, "unexpected layout");
+		}
+		catch (std::string const &err)
+		{
+			std::cerr << err << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+
+
+
+bool endian_modes()
+{
+	int const foreign = _native_big_endian ? little_endian_mode : big_endian_mode;
+	int const native  = _native_big_endian ? big_endian_mode : little_endian_mode;
+
+	// развороты векторными инструкциями и побайтово совпадают
+	{
+		vector<char> src(rnd(0, 1000)), simd(src.size()), scalar(src.size());
+		for (auto &c : src)
+			c = (char)rnd(0, 255);
+
+		_byteswap_range<2>(simd.data(), src.data(), src.size() / 2);
+		_byteswap_scalar<2>(scalar.data(), src.data(), src.size() / 2);
+		assert_eq(simd == scalar, true, "2-byte swap mismatch");
+		_byteswap_range<4>(simd.data(), src.data(), src.size() / 4);
+		_byteswap_scalar<4>(scalar.data(), src.data(), src.size() / 4);
+		assert_eq(simd == scalar, true, "4-byte swap mismatch");
+		_byteswap_range<8>(simd.data(), src.data(), src.size() / 8);
+		_byteswap_scalar<8>(scalar.data(), src.data(), src.size() / 8);
+		assert_eq(simd == scalar, true, "8-byte swap mismatch");
+	}
+
+	// порядок байт на выходе не зависит от машины
+	{
+		uint32_t value = 0x01020304;
+		string little, big;
+		serialize(little, &value, little_endian_mode);
+		serialize(big,    &value, big_endian_mode);
+		assert_eq(little, string("\x04\x03\x02\x01", 4), "little endian layout");
+		assert_eq(big,    string("\x01\x02\x03\x04", 4), "big endian layout");
+	}
+
+	// оба порядка байт сразу указать нельзя
+	{
+		bool thrown = false;
+		try
+		{
+			buffer_ostream buf;
+			archive(&buf, little_endian_mode | big_endian_mode);
+		}
+		catch (char const *)
+		{
+			thrown = true;
+		}
+		assert_eq(thrown, true, "conflicting byte orders must be rejected");
+	}
+
+	for (int _ = 0; _ < 100; ++_)
+	{
+		vector<int16_t>  shorts(rnd(0, 300)), shortsr;
+		vector<uint32_t> uints(rnd(0, 300)),  uintsr;
+		vector<double>   dbls = random_value<vector<double>>(), dblsr;
+		vector<Point>    points(rnd(0, 20)),  pointsr;
+		map<int, float>  floats;
+		map<int, float>  floatsr;
+		long long        llong = random_value<long long>(), llongr;
+
+		for (auto &v : shorts)
+			v = random_value<int16_t>();
+		for (auto &v : uints)
+			v = random_value<uint32_t>();
+		for (auto &p : points)
+			p = { random_value<double>(), random_value<double>(), random_value<int>() };
+		for (int i = rnd(0, 20); i; --i)
+			floats[random_value<int>()] = random_value<float>();
+
+		int mode = foreign | (rnd(0, 1) ? aligned_mode : 0) | (rnd(0, 1) ? varint_mode : 0);
+
+		buffer_ostream buf;
+		archive(&buf, mode) << &shorts << &uints << &dbls << &points << &floats << &llong;
+
+		memory_istream ms(buf.data(), buf.size());
+		archive(&ms, mode) >> &shortsr >> &uintsr >> &dblsr >> &pointsr >> &floatsr >> &llongr;
+
+		// в родном порядке массив записывается как есть, в чужом — развёрнутым
+		buffer_ostream nbuf, fbuf;
+		archive(&nbuf, native)  << &uints;
+		archive(&fbuf, foreign) << &uints;
+		string expected(nbuf.data(), nbuf.size());
+		_byteswap_scalar<4>(&expected[0], expected.data(), expected.size() / 4);
+
+		try
+		{
+			assert_eq(shorts, shortsr, "shorts != shortsr");
+			assert_eq(uints,  uintsr,  "uints != uintsr");
+			assert_eq(dbls,   dblsr,   "dbls != dblsr");
+			assert_eq(points, pointsr, "points != pointsr");
+			assert_eq(floats == floatsr, true, "floats != floatsr");
+			assert_eq(llong,  llongr,  "llong != llongr");
+			assert_eq(ms.remaining(), (size_t)0, "Not all bytes were read");
+
+			string plain;
+			serialize(plain, &uints);
+			assert_eq(string(nbuf.data(), nbuf.size()), plain, "native order must not change layout");
+			assert_eq(string(fbuf.data(), fbuf.size()), expected, "foreign order layout");
+		}
+		catch (std::string const &err)
+		{
+			std::cerr << err << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+
+
+
+// END
@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <iostream>
+#include <map>
+
+#include <nvx/iostream.hpp>
+#include <nvx/type.hpp>
+
+#include <assert.hpp>
+#include <random_value.hpp>
+
+#include <serialization_mmap.hpp>
+
+
+using namespace nvx;
+using namespace std;
+
+
+
+
+
+bool mmap_streams()
+{
+	const char *filename = "/tmp/nvx_mmap_streams.bin";
+
+	for (int _ = 0; _ < 20; ++_)
+	{
+		vector<double>   vec(rnd(0, 100000));
+		map<int, string> strmap = random_value<map<int, string>>();
+		string           str    = random_value<string>();
+		for (auto &val : vec)
+			val = random_value<double>();
+
+		// маленькое начальное отображение, чтобы файл рос
+		size_t written;
+		{
+			mmap_ostream out(filename, 1);
+			assert_eq(out.is_open(), true);
+			archive(&out) << &vec << &strmap << &str;
+			assert_eq((bool)out, true);
+			written = out.tellp();
+		}
+
+		mmap_istream in(filename);
+		assert_eq(in.is_open(), true);
+		assert_eq(in.size(), written);
+
+		vector<double>   vecr;
+		map<int, string> strmapr;
+		string_view      strr;
+		archive(&in) >> &vecr >> &strmapr >> &strr;
+
+		assert_eq((bool)in, true);
+		assert_eq(in.remaining(), (size_t)0);
+		assert_eq(vecr, vec);
+		assert_eq(strmapr, strmap);
+		assert_eq(string(strr), str);
+	}
+
+	remove(filename);
+
+	mmap_istream missing("/nonexistent/nvx_mmap_streams.bin");
+	int val;
+	assert_eq(missing.is_open(), false);
+	assert_eq(archive(&missing) >> &val ? true : false, false);
+
+	return true;
+}
+
+
+
+
+
+// END
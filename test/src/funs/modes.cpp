@@ -0,0 +1,136 @@
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+
+#include <nvx/iostream.hpp>
+#include <nvx/type.hpp>
+
+#include <assert.hpp>
+#include <random_value.hpp>
+
+#include <serialization.hpp>
+
+
+using namespace nvx;
+using namespace std;
+
+
+
+
+
+/************************** STRUCTS *************************/
+struct ModePoint
+{
+	int    x;
+	double y;
+
+	NVX_SERIALIZABLE_PLAIN();
+};
+
+struct ModeRecord
+{
+	string                    name;
+	vector<int>               values;
+	map<int, ModePoint>       points;
+	vector<shared_ptr<int>>   shared;
+	vector<int *>             ptrs;
+
+	NVX_SERIALIZABLE(&name, &values, &points, &shared, &ptrs);
+};
+
+
+
+
+
+/************************** TESTS ***************************/
+/*
+ * Архив с режимом Mode пишет то же, что и архив с тем же
+ * режимом, заданным при создании, и читает это обратно
+ */
+template<int Mode>
+static void check_static_mode(ModeRecord const &rec)
+{
+	buffer_ostream dyn, stat;
+	archive<buffer_ostream>(&dyn, Mode) << &rec;
+	archive<buffer_ostream, void, Mode>(&stat) << &rec;
+	assert_eq(string(stat.data(), stat.size()), string(dyn.data(), dyn.size()));
+
+	ModeRecord res;
+	memory_istream ms(stat.data(), stat.size());
+	archive<memory_istream, void, Mode> arch(&ms);
+	arch >> &res;
+
+	assert_eq(ms.remaining(), (size_t)0);
+	assert_eq(res.name, rec.name);
+	assert_eq(res.values == rec.values, true);
+	assert_eq(res.points.size(), rec.points.size());
+	assert_eq(res.shared.size(), rec.shared.size());
+	for (size_t i = 0; i < res.shared.size(); ++i)
+	{
+		assert_eq(*res.shared[i], *rec.shared[i]);
+		if (Mode & determine_shared_mode)
+			assert_eq(res.shared[i] == res.shared[0], rec.shared[i] == rec.shared[0]);
+	}
+	for (size_t i = 0; i < res.ptrs.size(); ++i)
+	{
+		assert_eq(*res.ptrs[i], *rec.ptrs[i]);
+		if (Mode & determine_pointers_mode)
+			assert_eq(res.ptrs[i] == res.ptrs[0], rec.ptrs[i] == rec.ptrs[0]);
+	}
+
+	set<int *> owned(res.ptrs.begin(), res.ptrs.end());
+	for (int *p : owned)
+		delete p;
+	return;
+}
+
+bool static_modes()
+{
+	for (int _ = 0; _ < 20; ++_)
+	{
+		int a = rnd(-100, 100), b = rnd(-100, 100);
+
+		ModeRecord rec;
+		rec.name = random_value<string>();
+		rec.values.resize(rnd(0, 300), rnd(-5, 5));
+		for (int i = rnd(0, 10); i; --i)
+			rec.points[rnd(0, 1000)] = { rnd(0, 10), rnd(0, 10) / 3.0 };
+
+		auto shared = make_shared<int>(a);
+		rec.shared = { shared, make_shared<int>(b), shared };
+		rec.ptrs   = { &a, &b, &a, &a };
+
+		check_static_mode<none_mode>(rec);
+		check_static_mode<varint_mode | delta_mode>(rec);
+		check_static_mode<determine_shared_mode>(rec);
+		check_static_mode<determine_pointers_mode | determine_shared_mode>(rec);
+		check_static_mode<chunked_mode | aligned_mode>(rec);
+		check_static_mode<iterative_mode | determine_pointers_mode>(rec);
+	}
+
+	// архивы без указателей не хранят таблиц
+	static_assert(
+		sizeof(archive<buffer_ostream, void, none_mode>) <
+		sizeof(archive<buffer_ostream, void, determine_shared_mode>)
+	);
+
+	buffer_ostream out;
+	assert_eq(archive<buffer_ostream, void, none_mode>(&out).get_mode(), (int)none_mode);
+	assert_eq(archive<buffer_ostream, void, none_mode>(&out).tracked(), (size_t)0);
+
+	// режим, переданный конструктору, должен совпадать с Mode
+	bool thrown = false;
+	try
+	{
+		archive<buffer_ostream, void, none_mode> arch(&out, varint_mode);
+	}
+	catch (char const *)
+	{
+		thrown = true;
+	}
+	assert_eq(thrown, true);
+
+	return true;
+}
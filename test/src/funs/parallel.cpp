@@ -0,0 +1,229 @@
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include <nvx/iostream.hpp>
+#include <nvx/type.hpp>
+
+#include <assert.hpp>
+#include <random_value.hpp>
+
+#include <serialization_parallel.hpp>
+
+
+using namespace nvx;
+using namespace std;
+
+
+
+
+
+/************************** STRUCTS *************************/
+struct Record
+{
+	string      name;
+	vector<int> values;
+
+	bool operator==(Record const &rhs) const
+	{
+		return name == rhs.name && values == rhs.values;
+	}
+
+	NVX_SERIALIZABLE(&name, &values);
+};
+
+
+
+
+
+/************************** TESTS ***************************/
+bool parallel_serialization()
+{
+	int const modes[] = {
+		determine_shared_mode,
+		none_mode,
+		varint_mode | delta_mode,
+		chunked_mode,
+		(_native_big_endian ? little_endian_mode : big_endian_mode)
+	};
+
+	for (int _ = 0; _ < 20; ++_)
+	{
+		vector<Record> records(rnd(0, 20000));
+		for (auto &r : records)
+		{
+			r.name = random_value<string>();
+			r.values.resize(rnd(0, rnd(0, 1) ? 3 : 300), rnd(-5, 5));
+		}
+
+		int mode = modes[rnd(0, 4)];
+
+		// результат совпадает с последовательной записью
+		buffer_ostream seq, par;
+		archive(&seq, mode) << &records;
+		archive<buffer_ostream> arch(&par, mode);
+		int n = serialize_parallel(arch, &records, rnd(1, 8), rnd(1, 2000));
+
+		assert_eq((size_t)n, par.size());
+		assert_eq(string(par.data(), par.size()), string(seq.data(), seq.size()));
+
+		vector<Record> recordsr;
+		memory_istream ms(par.data(), par.size());
+		archive(&ms, mode) >> &recordsr;
+		assert_eq(recordsr == records, true);
+	}
+
+	// разделяемые указатели записываются последовательно
+	{
+		auto shared = make_shared<int>(42);
+		vector<shared_ptr<int>> ptrs(10000);
+		for (auto &p : ptrs)
+			p = rnd(0, 1) ? shared : make_shared<int>(rnd(0, 100));
+
+		buffer_ostream seq, par;
+		archive(&seq) << &ptrs;
+		archive<buffer_ostream> arch(&par);
+		serialize_parallel(arch, &ptrs, 4, 100);
+		assert_eq(string(par.data(), par.size()), string(seq.data(), seq.size()));
+
+		vector<shared_ptr<int>> ptrsr;
+		memory_istream ms(par.data(), par.size());
+		archive(&ms) >> &ptrsr;
+		assert_eq(ptrsr.size(), ptrs.size());
+		for (size_t i = 0; i < ptrs.size(); ++i)
+			assert_eq(*ptrsr[i], *ptrs[i]);
+	}
+
+	return true;
+}
+
+
+
+
+
+bool indexed_serialization()
+{
+	int const modes[] = {
+		determine_shared_mode,
+		varint_mode,
+		(_native_big_endian ? little_endian_mode : big_endian_mode)
+	};
+
+	for (int _ = 0; _ < 20; ++_)
+	{
+		vector<Record> records(rnd(0, 20000));
+		for (auto &r : records)
+		{
+			r.name = random_value<string>();
+			r.values.resize(rnd(0, rnd(0, 1) ? 3 : 300), rnd(-5, 5));
+		}
+
+		int    mode    = modes[rnd(0, 2)];
+		string trailer = random_value<string>();
+
+		buffer_ostream buf;
+		archive<buffer_ostream> arch(&buf, mode);
+		int n = serialize_indexed(arch, &records, rnd(1, 8), rnd(1, 2000));
+		arch << &trailer;
+		assert_eq((size_t)n + serialized_size(&trailer, mode), buf.size());
+		string indexed(buf.data(), buf.size());
+
+		// параллельное чтение из памяти и из обычного потока
+		{
+			vector<Record> recordsr(rnd(0, 10));
+			string         trailerr;
+			memory_istream ms(indexed.data(), indexed.size());
+			archive<memory_istream> in(&ms, mode);
+			assert_eq(deserialize_parallel(in, &recordsr, rnd(1, 8)), n);
+			in >> &trailerr;
+			assert_eq(recordsr == records, true);
+			assert_eq(trailerr, trailer);
+			assert_eq(ms.remaining(), (size_t)0);
+		}
+		{
+			vector<Record> recordsr;
+			string         trailerr;
+			stringstream   ss(indexed);
+			archive<stringstream> in(&ss, mode);
+			deserialize_parallel(in, &recordsr, rnd(1, 8));
+			in >> &trailerr;
+			assert_eq(recordsr == records, true);
+			assert_eq(trailerr, trailer);
+		}
+
+		// обычная десериализация пропускает таблицу смещений
+		{
+			vector<Record> recordsr;
+			string         trailerr;
+			memory_istream ms(indexed.data(), indexed.size());
+			archive(&ms, mode) >> &recordsr >> &trailerr;
+			assert_eq(recordsr == records, true);
+			assert_eq(trailerr, trailer);
+		}
+
+		// а параллельная читает обычный формат
+		{
+			buffer_ostream plain;
+			archive(&plain, mode) << &records << &trailer;
+
+			vector<Record> recordsr;
+			string         trailerr;
+			memory_istream ms(plain.data(), plain.size());
+			archive<memory_istream> in(&ms, mode);
+			deserialize_parallel(in, &recordsr);
+			in >> &trailerr;
+			assert_eq(recordsr == records, true);
+			assert_eq(trailerr, trailer);
+		}
+
+		// обрезанные данные не читаются
+		if (!records.empty())
+		{
+			vector<Record> recordsr;
+			memory_istream ms(indexed.data(), rnd(0, n - 1));
+			archive<memory_istream> in(&ms, mode);
+			assert_eq(deserialize_parallel(in, &recordsr, rnd(1, 8)), 0);
+		}
+	}
+
+	// длины частей и размер из повреждённого заголовка не
+	// приводят к огромным выделениям памяти и переполнению
+	// результата
+	struct header_t
+	{
+		int32_t size, chunk;
+		vector<ullong> lengths;
+	};
+	vector<header_t> const corrupt = {
+		{ 2, 1, { 1ull << 40, 5 } },
+		{ 2, 1, { (ullong)numeric_limits<int>::max() - 4, 8 } },
+		{ 2, 1, { ~0ull, 2 } },
+		{ numeric_limits<int32_t>::max(), numeric_limits<int32_t>::max(), { 0 } }
+	};
+	for (auto const &h : corrupt)
+	{
+		buffer_ostream buf;
+		archive<buffer_ostream> arch(&buf, none_mode);
+		_serialize_index(arch, h.size, h.chunk, h.lengths);
+		string header(buf.data(), buf.size());
+
+		vector<Record> recordsr;
+		stringstream ss(header + string(16, '\0'));
+		archive<stringstream> in(&ss, none_mode);
+		assert_eq(deserialize_parallel(in, &recordsr), 0);
+		assert_eq(recordsr.size() <= 16, true);
+
+		memory_istream ms(header.data(), header.size());
+		archive<memory_istream> mem(&ms, none_mode);
+		assert_eq(deserialize_parallel(mem, &recordsr), 0);
+		assert_eq(recordsr.size() <= 16, true);
+	}
+
+	return true;
+}
+
+
+
+
+
+// END
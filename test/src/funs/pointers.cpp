@@ -1,4 +1,6 @@
 #include <iostream>
+#include <map>
+#include <set>
 #include <memory>
 #include <sstream>
 
@@ -60,6 +62,148 @@ inline Ostream &operator<<( Ostream &os, Node const &toprint )
 
 
 
+// узел, не владеющий потомками: при загрузке в арену
+// они освобождаются вместе с ней
+struct ArenaNode
+{
+	int val = 0;
+	vector<ArenaNode *> childs;
+
+	NVX_SERIALIZABLE(&val, &childs);
+};
+
+bool equal_nodes(Node const *lhs, ArenaNode const *rhs)
+{
+	if (lhs->val != rhs->val || lhs->childs.size() != rhs->childs.size())
+		return false;
+
+	for (size_t i = 0; i < lhs->childs.size(); ++i)
+	{
+		if ( !equal_nodes(lhs->childs[i], rhs->childs[i]) )
+			return false;
+	}
+
+	return true;
+}
+
+
+
+
+
+// звенья длинных списков для режима iterative_mode
+struct ListNode
+{
+	int val = 0;
+	ListNode *next = nullptr;
+
+	NVX_SERIALIZABLE(&val, &next);
+};
+
+struct UniqueListNode
+{
+	int val = 0;
+	unique_ptr<UniqueListNode> next;
+
+	NVX_SERIALIZABLE(&val, &next);
+};
+
+struct SharedListNode
+{
+	int val = 0;
+	shared_ptr<SharedListNode> next;
+
+	NVX_SERIALIZABLE(&val, &next);
+};
+
+// рекурсивный деструктор переполнил бы стек
+template<typename P>
+void unlink_list(P &head)
+{
+	while (head)
+		head = std::move(head->next);
+}
+
+// ключ, упорядоченный по значению, на которое он указывает
+struct Keyed
+{
+	int val = 0;
+
+	NVX_SERIALIZABLE(&val);
+};
+
+struct ByVal
+{
+	bool operator()(unique_ptr<Keyed> const &lhs, unique_ptr<Keyed> const &rhs) const
+	{
+		return lhs->val < rhs->val;
+	}
+};
+
+// after_deserialization читает объекты, на которые указывает узел
+struct HookedNode
+{
+	int val = 0;
+	int sum = 0;
+	vector<unique_ptr<HookedNode>> childs;
+	set<unique_ptr<Keyed>, ByVal>  keys;
+
+	int expected_sum() const
+	{
+		int res = val;
+		for (auto &child : childs)
+			res += child->val;
+		for (auto &key : keys)
+			res += key->val;
+		return res;
+	}
+
+	void after_deserialization()
+	{
+		sum = expected_sum();
+	}
+
+	NVX_SERIALIZABLE(&val, &childs, &keys);
+};
+
+unique_ptr<HookedNode> hooked_node(int depth)
+{
+	unique_ptr<HookedNode> node(new HookedNode);
+	node->val = rnd(1, 1000);
+	for (int i = rnd(1, 5); i; --i)
+	{
+		unique_ptr<Keyed> key(new Keyed);
+		key->val = rnd(1, 1000);
+		node->keys.insert(std::move(key));
+	}
+	for (int i = depth > 0 ? rnd(1, 3) : 0; i; --i)
+		node->childs.push_back(hooked_node(depth - 1));
+	return node;
+}
+
+bool equal_hooked(HookedNode const *lhs, HookedNode const *rhs)
+{
+	if (
+		lhs->val != rhs->val || rhs->sum != rhs->expected_sum() ||
+		lhs->keys.size() != rhs->keys.size() || lhs->childs.size() != rhs->childs.size()
+	)
+		return false;
+
+	auto key = rhs->keys.begin();
+	for (auto &lkey : lhs->keys)
+		if (lkey->val != (*key++)->val)
+			return false;
+
+	for (size_t i = 0; i < lhs->childs.size(); ++i)
+		if (!equal_hooked(lhs->childs[i].get(), rhs->childs[i].get()))
+			return false;
+
+	return true;
+}
+
+
+
+
+
 /************************ RANDOM NODE ***********************/
 Node *random_node(int maxdepth)
 {
@@ -108,6 +252,260 @@ bool pointers()
 	return true;
 }
 
+bool arena_pointers()
+{
+	for (int _ = 0; _ < 20; ++_)
+	{
+		stringstream ss;
+
+		unique_ptr<Node> node(random_value<Node *>());
+		Node *nodep = node.get();
+		string name;
+		archive(&ss) << &nodep << &name;
+
+		string *strs = new string[3] { "first", "second", "third" };
+		int size = 3;
+		{
+			archive out(&ss);
+			serialize_array(out, &strs, &size);
+		}
+		delete[] strs;
+
+		unique_ptr<arena> ar;
+		ArenaNode *noder;
+		string *strsr;
+		int sizer;
+		{
+			archive in(&ss);
+			in.enable_arena(256);
+			in >> &noder;
+			in >> &name;
+			deserialize_array(in, &strsr, &sizer);
+			ar = in.release_arena();
+			assert_eq(in.get_arena(), (arena *)nullptr);
+		}
+
+		assert_eq(equal_nodes(node.get(), noder), true);
+		assert_eq(sizer, 3);
+		assert_eq(strsr[2], string("third"));
+		assert_eq(ar->size() > 0, true);
+	}
+
+	return true;
+}
+
+bool iterative_pointers()
+{
+	const int len = 300000;
+
+	// обычные указатели, последний указывает на первый
+	{
+		arena nodes;
+		ListNode *head = nodes.create<ListNode>();
+		ListNode *cur = head;
+		for (int i = 1; i < len; ++i)
+		{
+			cur->next = nodes.create<ListNode>();
+			cur = cur->next;
+			cur->val = i;
+		}
+		cur->next = head;
+
+		stringstream ss;
+		archive(&ss, iterative_mode | determine_pointers_mode) << &head;
+
+		ListNode *headr;
+		archive in(&ss, iterative_mode | determine_pointers_mode);
+		in.enable_arena();
+		in >> &headr;
+
+		cur = headr;
+		for (int i = 0; i < len; ++i, cur = cur->next)
+			assert_eq(cur->val, i);
+		assert_eq(cur, headr);
+	}
+
+	// unique_ptr
+	{
+		unique_ptr<UniqueListNode> head;
+		for (int i = len-1; i >= 0; --i)
+		{
+			unique_ptr<UniqueListNode> node(new UniqueListNode);
+			node->val = i;
+			node->next = std::move(head);
+			head = std::move(node);
+		}
+
+		stringstream ss;
+		archive(&ss, iterative_mode) << &head;
+
+		unique_ptr<UniqueListNode> headr;
+		archive(&ss, iterative_mode) >> &headr;
+
+		UniqueListNode *cur = headr.get();
+		for (int i = 0; i < len; ++i, cur = cur->next.get())
+			assert_eq(cur->val, i);
+		assert_eq(cur, (UniqueListNode *)nullptr);
+
+		unlink_list(head);
+		unlink_list(headr);
+	}
+
+	// shared_ptr
+	{
+		shared_ptr<SharedListNode> head;
+		for (int i = len-1; i >= 0; --i)
+		{
+			auto node = make_shared<SharedListNode>();
+			node->val = i;
+			node->next = std::move(head);
+			head = std::move(node);
+		}
+
+		stringstream ss;
+		archive(&ss, iterative_mode | determine_shared_mode) << &head;
+
+		shared_ptr<SharedListNode> headr;
+		{
+			archive in(&ss, iterative_mode | determine_shared_mode);
+			in >> &headr;
+		}
+
+		SharedListNode *cur = headr.get();
+		for (int i = 0; i < len; ++i, cur = cur->next.get())
+			assert_eq(cur->val, i);
+
+		unlink_list(head);
+		unlink_list(headr);
+	}
+
+	// ветвящиеся деревья
+	for (int _ = 0; _ < 50; ++_)
+	{
+		stringstream ss;
+
+		unique_ptr<Node> node(random_value<Node *>());
+		Node *nodep = node.get();
+		archive(&ss, iterative_mode) << &nodep;
+
+		Node *noderp;
+		archive(&ss, iterative_mode) >> &noderp;
+		unique_ptr<Node> noder(noderp);
+
+		assert_eq(*node, *noder);
+	}
+
+	// after_deserialization и вставка в set видят прочитанные
+	// объекты, на которые указывают узлы из очереди
+	for (int _ = 0; _ < 20; ++_)
+	{
+		unique_ptr<HookedNode> root = hooked_node(4), rootr;
+		int mode = iterative_mode | (rnd(0, 1) ? chunked_mode : 0);
+
+		stringstream ss;
+		archive(&ss, mode) << &root;
+		archive(&ss, mode) >> &rootr;
+
+		assert_eq(equal_hooked(root.get(), rootr.get()), true);
+	}
+
+	return true;
+}
+
+bool pointer_tables()
+{
+	// много объектов, на каждый указывают несколько раз
+	for (int _ = 0; _ < 10; ++_)
+	{
+		vector<unique_ptr<int>> owned;
+		vector<int *> ptrs;
+		for (int i = 0, e = rnd(100, 3000); i != e; ++i)
+		{
+			if (owned.empty() || rnd(0, 2) == 0)
+			{
+				owned.emplace_back(new int(random_value<int>()));
+				ptrs.push_back(owned.back().get());
+			}
+			else
+				ptrs.push_back(owned[rnd(0, (int)owned.size()-1)].get());
+		}
+
+		stringstream ss;
+		archive(&ss, determine_pointers_mode) << &ptrs;
+
+		vector<int *> ptrsr;
+		archive(&ss, determine_pointers_mode) >> &ptrsr;
+
+		assert_eq(ptrs.size(), ptrsr.size());
+		for (size_t i = 0; i < ptrs.size(); ++i)
+		{
+			assert_eq(*ptrs[i], *ptrsr[i]);
+			for (size_t j = 0; j < i; ++j)
+				assert_eq(ptrs[i] == ptrs[j], ptrsr[i] == ptrsr[j]);
+		}
+
+		set<int *> distinct(ptrsr.begin(), ptrsr.end());
+		for (int *p : distinct)
+			delete p;
+	}
+
+	// удаление из хеш-таблицы не должно терять соседей по цепочке
+	_flat_table<int, int, -1> table;
+	map<int, int> model;
+	for (int i = 0; i < 20000; ++i)
+	{
+		int key = rnd(0, 500);
+		if (rnd(0, 2) == 0)
+			assert_eq(table.erase(key), (bool)model.erase(key));
+		else
+			table[key] = model[key] = i;
+	}
+
+	assert_eq(table.size(), model.size());
+	for (int key = 0; key <= 500; ++key)
+	{
+		int *val = table.find(key);
+		auto it = model.find(key);
+		assert_eq(val != nullptr, it != model.end());
+		if (val)
+			assert_eq(*val, it->second);
+	}
+
+	// идентификаторы не по порядку: далёкий попадает в хеш-таблицу,
+	// а затем массив дорастает до него
+	int marker = 0;
+	_id_table ids;
+	ids[200].ptr  = &marker;
+	ids[200].type = &_type_tag<int *>::tag;
+	for (nvx::id_t id = 0; id <= 250; ++id)
+		if (id != 200)
+			ids[id].type = &_type_tag<int *>::tag;
+
+	assert_eq(ids.find(200) != nullptr, true);
+	assert_eq(ids.find(200)->get<int *>(), &marker);
+	assert_eq(ids[200].get<int *>(), &marker);
+	assert_eq(ids.find(200)->get<int *>(), &marker);
+	assert_eq(ids.find(300) == nullptr, true);
+	assert_eq(ids.erase(200), true);
+	assert_eq(ids.find(200) == nullptr, true);
+	assert_eq(ids.erase(200), false);
+
+	// идентификаторы из потока, каждый вдвое дальше предыдущего,
+	// не раздувают массив до последнего из них
+	_id_table far;
+	vector<nvx::id_t> farids;
+	for (nvx::id_t id = 64; id < numeric_limits<nvx::id_t>::max() / 2; id = 2 * id + 64)
+	{
+		far[id].type = &_type_tag<int *>::tag;
+		farids.push_back(id);
+	}
+	for (nvx::id_t id : farids)
+		assert_eq(far.find(id) != nullptr, true);
+	assert_eq(far.find(65) == nullptr, true);
+
+	return true;
+}
+
 
 
 
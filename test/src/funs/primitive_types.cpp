@@ -107,4 +107,111 @@ bool primitive_types()
 
 
 
+bool varint_primitive_types()
+{
+	for (int i = 0; i < 100; ++i)
+	{
+		short   shortval  = uidis_t<short>(  short_min,  short_max  )(dre), shortvalr;
+		int     intval    = uidis_t<int>(    int_min,    int_max    )(dre), intvalr;
+		llong   llongval  = uidis_t<llong>(  llong_min,  llong_max  )(dre), llongvalr;
+		uint    uintval   = uidis_t<uint>(   uint_min,   uint_max   )(dre), uintvalr;
+		ullong  ullongval = uidis_t<ullong>( ullong_min, ullong_max )(dre), ullongvalr;
+		wchar_t wcharval  = uidis_t<int>(    0,          0x10ffff   )(dre), wcharvalr;
+		int     extremes[] = { int_min, int_max, -1, 0, 1, -64, 63, 64 }, extremesr[8];
+		double  doubleval = urdis_t<double>()(dre), doublevalr;
+
+		vector<int> small(rnd(0, 100)), smallr;
+		for (int &v : small)
+			v = rnd(-60, 60);
+
+		int    *ptr = &intval, *ptrr = nullptr;
+		string  str = random_value<string>(), strr;
+
+		buffer_ostream buf;
+		archive out(&buf, varint_mode | determine_pointers_mode);
+		out <<
+			&shortval  <<
+			&intval    <<
+			&llongval  <<
+			&uintval   <<
+			&ullongval <<
+			&wcharval  <<
+			&doubleval <<
+			&small     <<
+			&ptr       <<
+			&str;
+		serialize_static(out, extremes, 8);
+
+		memory_istream ms(buf.data(), buf.size());
+		archive in(&ms, varint_mode | determine_pointers_mode);
+		in >>
+			&shortvalr  >>
+			&intvalr    >>
+			&llongvalr  >>
+			&uintvalr   >>
+			&ullongvalr >>
+			&wcharvalr  >>
+			&doublevalr >>
+			&smallr     >>
+			&ptrr       >>
+			&strr;
+		deserialize_static(in, extremesr, 8);
+
+		try
+		{
+			assert_eq(shortval,  shortvalr,  "Equal fail: shortval != shortvalr");
+			assert_eq(intval,    intvalr,    "Equal fail: intval != intvalr");
+			assert_eq(llongval,  llongvalr,  "Equal fail: llongval != llongvalr");
+			assert_eq(uintval,   uintvalr,   "Equal fail: uintval != uintvalr");
+			assert_eq(ullongval, ullongvalr, "Equal fail: ullongval != ullongvalr");
+			assert_eq((int)wcharval, (int)wcharvalr, "Equal fail: wcharval != wcharvalr");
+			assert_eq(doubleval, doublevalr, "Equal fail: doubleval != doublevalr");
+			assert_eq(small,     smallr,     "Equal fail: small != smallr");
+			assert_eq(*ptr,      *ptrr,      "Equal fail: *ptr != *ptrr");
+			assert_eq(str,       strr,       "Equal fail: str != strr");
+			assert_eq(extremes, extremes+8, extremesr, extremesr+8, "Equal fail: extremes != extremesr");
+			assert_eq(ms.remaining(), (size_t)0, "Not all bytes were read");
+			int32_t smallsize = small.size();
+			assert_eq(
+				serialized_size(&small, varint_mode),
+				serialized_size(&smallsize, varint_mode) + (int)small.size(),
+				"Small values should take one byte"
+			);
+		}
+		catch (std::string const &err)
+		{
+			std::cerr << err << std::endl;
+			delete ptrr;
+			return false;
+		}
+
+		delete ptrr;
+	}
+
+	// слишком длинные и переполняющие тип записи не читаются
+	{
+		string const longer  = "\x80\x80\x80\x80\x80\x01";    // 6 байт для uint32_t
+		string const highbit = "\xff\xff\xff\xff\x1f";         // 35 бит
+		string const maximal = "\xff\xff\xff\xff\x0f";         // UINT32_MAX
+
+		uint32_t value = 7;
+		assert_eq(deserialize(longer, &value, varint_mode), 0);
+		assert_eq(deserialize(highbit, &value, varint_mode), 0);
+		assert_eq(value, (uint32_t)7);
+		assert_eq(deserialize(maximal, &value, varint_mode), 5);
+		assert_eq(value, numeric_limits<uint32_t>::max());
+
+		uint64_t big;
+		assert_eq(deserialize(string(9, '\xff') + "\x02", &big, varint_mode), 0);
+		assert_eq(deserialize(string(9, '\xff') + "\x01", &big, varint_mode), 10);
+		assert_eq(big, numeric_limits<uint64_t>::max());
+	}
+
+	return true;
+}
+
+
+
+
+
 // END
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+
+#include <nvx/iostream.hpp>
+#include <nvx/type.hpp>
+
+#include <assert.hpp>
+#include <random_value.hpp>
+
+#include <serialization.hpp>
+
+
+using namespace nvx;
+using namespace std;
+
+
+
+
+
+#ifdef NVX_SERIALIZATION_STATS
+/************************** STRUCTS *************************/
+struct StatsPoint
+{
+	int x, y;
+
+	NVX_SERIALIZABLE_PLAIN();
+};
+
+struct StatsItem
+{
+	int         id;
+	vector<int> values;
+
+	NVX_SERIALIZABLE(&id, &values);
+};
+
+
+
+
+
+/************************** TESTS ***************************/
+// Тесты собираются с NVX_SERIALIZATION_STATS (см. makefile)
+bool archive_statistics()
+{
+	// категории объектов и обращения к потоку
+	{
+		vector<int> v(100, 7);
+		StatsPoint  p { 1, 2 };
+		StatsItem   item { 5, { 1, 2, 3 } };
+
+		buffer_ostream out;
+		archive<buffer_ostream> arch(&out, none_mode);
+		arch << &v << &p << &item;
+
+		auto &st = arch.stats();
+		assert_eq(st.container.calls, (ullong)2);
+		assert_eq(st.container.bytes, (ullong)(4 + 400 + 4 + 12));
+		assert_eq(st.plain.calls, (ullong)1);
+		assert_eq(st.plain.bytes, (ullong)sizeof p);
+		assert_eq(st.object.calls, (ullong)1);
+		assert_eq(st.object.bytes, (ullong)(4 + 4 + 12));
+		assert_eq(st.fundamental.calls, (ullong)3);
+		assert_eq(st.fundamental.bytes, (ullong)12);
+		assert_eq(st.pointer.calls + st.shared.calls, (ullong)0);
+		assert_eq(st.written, (ullong)out.size());
+		assert_eq(st.writes, (ullong)6);
+		assert_eq(st.seconds > 0, true);
+
+		// подсчёт размера без записи не учитывается
+		serialize(arch, &v, false);
+		assert_eq(st.container.calls, (ullong)2);
+
+		memory_istream in(out.data(), out.size());
+		archive<memory_istream> arch2(&in, none_mode);
+		vector<int> vr;
+		StatsPoint  pr;
+		StatsItem   itemr;
+		arch2 >> &vr >> &pr >> &itemr;
+
+		auto &st2 = arch2.stats();
+		assert_eq(st2.read, (ullong)out.size());
+		assert_eq(st2.container.calls, (ullong)2);
+		assert_eq(st2.container.bytes, st.container.bytes);
+		assert_eq(st2.plain.bytes, st.plain.bytes);
+		assert_eq(st2.object.bytes, st.object.bytes);
+		assert_eq(st2.fundamental.calls, st.fundamental.calls);
+		assert_eq(st2.writes, (ullong)0);
+
+		arch2.reset_stats();
+		assert_eq(st2.read + st2.reads + st2.container.calls, (ullong)0);
+		assert_eq(st2.seconds, 0.0);
+	}
+
+	// попадания в таблицы указателей
+	int const modes[] = { determine_pointers_mode, determine_shared_mode };
+	for (int mode : modes)
+	{
+		bool pointers = mode & determine_pointers_mode;
+
+		int a = 1, b = 2;
+		vector<int *> ptrs = { &a, &a, &b, nullptr, &b, &a };
+		vector<shared_ptr<int>> shared = { make_shared<int>(1), nullptr };
+		shared.push_back(shared[0]);
+
+		stringstream ss;
+		archive arch(&ss, mode);
+		arch << &ptrs << &shared;
+
+		auto &st = arch.stats();
+		assert_eq(st.pointer.calls, (ullong)6);
+		assert_eq(st.shared.calls, (ullong)3);
+
+		ullong hits   = pointers ? 3 : 1;
+		ullong misses = pointers ? 2 : 1;
+		assert_eq(st.hits, hits);
+		assert_eq(st.misses, misses);
+
+		vector<int *> ptrsr;
+		vector<shared_ptr<int>> sharedr;
+		archive arch2(&ss, mode);
+		arch2 >> &ptrsr >> &sharedr;
+
+		assert_eq(arch2.stats().hits, hits);
+		assert_eq(arch2.stats().misses, misses);
+		assert_eq(arch2.stats().read, arch.stats().written);
+
+		set<int *> owned(ptrsr.begin(), ptrsr.end());
+		for (int *p : owned)
+			delete p;
+	}
+
+	return true;
+}
+#else
+// без NVX_SERIALIZATION_STATS архив статистику не собирает
+bool archive_statistics()
+{
+	return true;
+}
+#endif
@@ -1,4 +1,8 @@
 #include <iostream>
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <set>
 #include <sstream>
 
 #include <nvx/iostream.hpp>
@@ -97,4 +101,405 @@ bool std_containers()
 
 
 
+bool delta_containers()
+{
+	for (int _ = 0; _ < 100; ++_)
+	{
+		map<llong, string>     dense,    denser;
+		set<int>               set,      setr;
+		multiset<short>        multiset, multisetr;
+		multimap<int, int>     multimap, multimapr;
+		std::set<int, greater<int>> desc, descr;
+
+		for (llong k = rnd(llong_min, llong_max - 1000), e = k + rnd(0, 500); k < e; ++k)
+			dense[k] = random_value<string>();
+
+		set      = random_value<decltype(set)>();
+		multiset = random_value<decltype(multiset)>();
+		multimap = random_value<decltype(multimap)>();
+		for (int i = 0, e = rnd(0, 50); i < e; ++i)
+			desc.insert(random_value<int>());
+		multiset.insert(short_min);
+		multiset.insert(short_max);
+		multiset.insert(short_max);
+
+		for (int mode : { (int)delta_mode, delta_mode | varint_mode })
+		{
+			buffer_ostream buf;
+			archive(&buf, mode) << &dense << &set << &multiset << &multimap << &desc;
+
+			memory_istream ms(buf.data(), buf.size());
+			archive(&ms, mode) >> &denser >> &setr >> &multisetr >> &multimapr >> &descr;
+
+			try
+			{
+				assert_eq(dense,    denser,    "Error: dense != denser");
+				assert_eq(set,      setr,      "Error: set != setr");
+				assert_eq(multiset, multisetr, "Error: multiset != multisetr");
+				assert_eq(multimap, multimapr, "Error: multimap != multimapr");
+				assert_eq(desc,     descr,     "Error: desc != descr");
+				assert_eq(ms.remaining(), (size_t)0, "Error: not all bytes were read");
+			}
+			catch (std::string const &err)
+			{
+				std::cerr << err << std::endl;
+				return false;
+			}
+		}
+
+		map<llong, int> ids;
+		for (int i = 0; i < 100; ++i)
+			ids[i] = i;
+		if (serialized_size(&ids, delta_mode) != 4 + 100 + 100 * 4)
+		{
+			std::cerr << "Error: dense keys are not delta encoded" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+
+
+
+bool ordered_containers()
+{
+	for (int _ = 0; _ < 50; ++_)
+	{
+		// равные ключи вставляются в конец и сохраняют порядок
+		multimap<int, int>                    multimap, multimapr;
+		multiset<string>                      multiset, multisetr;
+		map<int, string, greater<int>>        desc,     descr;
+		std::set<int, greater<int>>           rev;
+		std::set<int>                         revr;
+		std::multimap<int, int, greater<int>> revmulti;
+		std::multimap<int, int>               revmultir;
+
+		for (int i = 0, e = rnd(0, 300); i < e; ++i)
+		{
+			multimap.emplace(rnd(0, 5), i);
+			multiset.insert(string(rnd(0, 2), 'a'));
+			desc[random_value<int>()] = random_value<string>();
+			rev.insert(random_value<int>());
+			revmulti.emplace(rnd(0, 5), i);
+		}
+
+		for (int mode : { (int)determine_shared_mode, determine_shared_mode | iterative_mode })
+		{
+			buffer_ostream buf;
+			archive(&buf, mode) << &multimap << &multiset << &desc << &rev << &revmulti;
+
+			// элементы в обратном порядке (другой компаратор)
+			// тоже должны встать на свои места
+			memory_istream ms(buf.data(), buf.size());
+			archive(&ms, mode) >> &multimapr >> &multisetr >> &descr >> &revr >> &revmultir;
+
+			// неверная подсказка действует как обычная вставка:
+			// равные ключи остаются в порядке потока
+			std::multimap<int, int> revmultiexp;
+			for (auto const &kv : revmulti)
+				revmultiexp.insert(kv);
+
+			try
+			{
+				assert_eq(multimap, multimapr, "Error: multimap != multimapr");
+				assert_eq(multiset, multisetr, "Error: multiset != multisetr");
+				assert_eq(desc,     descr,     "Error: desc != descr");
+				assert_eq(std::set<int>(rev.begin(), rev.end()), revr, "Error: rev != revr");
+				assert_eq(revmultiexp, revmultir, "Error: revmulti != revmultir");
+				assert_eq(ms.remaining(), (size_t)0, "Error: not all bytes were read");
+			}
+			catch (std::string const &err)
+			{
+				std::cerr << err << std::endl;
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+
+
+bool unordered_geometry()
+{
+	for (int _ = 0; _ < 100; ++_)
+	{
+		unordered_map<int, string> map, mapr, mapg;
+		unordered_multiset<llong>  set, setr;
+
+		map = random_value<decltype(map)>();
+		set = random_value<decltype(set)>();
+		map.max_load_factor(0.5);
+		map.rehash(rnd(0, 1000));
+		set.max_load_factor(2);
+
+		buffer_ostream buf, plain;
+		archive(&buf, hash_geometry_mode | varint_mode) << &map << &set;
+		archive(&plain) << &map;
+
+		memory_istream ms(buf.data(), buf.size());
+		archive(&ms, hash_geometry_mode | varint_mode) >> &mapr >> &setr;
+
+		memory_istream pms(plain.data(), plain.size());
+		archive(&pms) >> &mapg;
+
+		try
+		{
+			assert_eq(map, mapr, "Error: map != mapr");
+			assert_eq(set, setr, "Error: set != setr");
+			assert_eq(map, mapg, "Error: map != mapg");
+			assert_eq(map.bucket_count(),    mapr.bucket_count(),    "Error: bucket_count differs");
+			assert_eq(map.max_load_factor(), mapr.max_load_factor(), "Error: max_load_factor differs");
+			assert_eq(set.max_load_factor(), setr.max_load_factor(), "Error: max_load_factor differs");
+		}
+		catch (std::string const &err)
+		{
+			std::cerr << err << std::endl;
+			return false;
+		}
+	}
+
+	// испорченная геометрия не приводит к огромной таблице
+	unordered_set<int> small = { 1, 2, 3 }, smallr;
+	buffer_ostream buf;
+	archive(&buf, hash_geometry_mode) << &small;
+
+	string data(buf.data(), buf.size());
+	ullong buckets = 1ull << 40;
+	float  load    = 1e-30f;
+	memcpy(&data[sizeof(int32_t)], &buckets, sizeof buckets);
+	memcpy(&data[sizeof(int32_t) + sizeof buckets], &load, sizeof load);
+
+	memory_istream ms(data.data(), data.size());
+	archive(&ms, hash_geometry_mode) >> &smallr;
+	assert_eq(small, smallr, "Error: small != smallr");
+	assert_eq(smallr.bucket_count() <= 2 * HASH_BUCKETS_LIMIT, true, "Error: bucket_count is not clamped");
+
+	// испорченный размер не приводит к огромной таблице,
+	// а чтение останавливается на конце данных
+	for (int mode : { (int)none_mode, (int)hash_geometry_mode })
+	{
+		buffer_ostream hdr;
+		archive head(&hdr, none_mode);
+		int32_t size = numeric_limits<int32_t>::max();
+		head << &size;
+		if (mode)
+		{
+			ullong buckets = 1ull << 40;
+			float  load    = 1;
+			head << &buckets << &load;
+		}
+		int elements[] = { 1, 2, 3 };
+		head << &elements[0] << &elements[1] << &elements[2];
+		string data(hdr.data(), hdr.size());
+
+		unordered_set<int> corrupt;
+		memory_istream ms(data.data(), data.size());
+		archive in(&ms, mode);
+		assert_eq((size_t)deserialize(in, &corrupt), data.size(), "Error: corrupt size read");
+		assert_eq(corrupt.size(), (size_t)3, "Error: corrupt set size");
+		assert_eq(corrupt.bucket_count() <= 4 * HASH_BUCKETS_LIMIT, true, "Error: corrupt size is trusted");
+
+		stringstream ss(data);
+		archive sin(&ss, mode);
+		unordered_set<int> corrupts;
+		deserialize(sin, &corrupts);
+		assert_eq(corrupts.size(), (size_t)3, "Error: corrupt set size");
+		assert_eq(corrupts.bucket_count() <= 4 * HASH_BUCKETS_LIMIT, true, "Error: corrupt size is trusted");
+	}
+
+	return true;
+}
+
+
+
+
+bool pmr_containers()
+{
+	typedef pmr::map<pmr::string, pmr::vector<pmr::string>> dict_t;
+
+	dict_t dict;
+	for (int i = 0; i < 50; ++i)
+	{
+		auto &words = dict[pmr::string(50, 'a' + i % 26) + to_string(i).c_str()];
+		for (int j = 0; j < i % 7; ++j)
+			words.emplace_back(40, 'a' + j);
+	}
+	auto shared = make_shared<pmr::vector<int>>(pmr::vector<int>{ 1, 2, 3 });
+
+	stringstream ss;
+	archive(&ss) << &dict << &shared;
+
+	/*
+	 * Всё, что создаётся при десериализации, должно попасть
+	 * в буфер: ресурс по умолчанию ничего не выделяет
+	 */
+	vector<char> storage(1 << 20);
+	pmr::monotonic_buffer_resource pool(storage.data(), storage.size(), pmr::null_memory_resource());
+	pmr::memory_resource *def = pmr::set_default_resource(pmr::null_memory_resource());
+
+	bool ok = true;
+	try
+	{
+		dict_t dictr(&pool);
+		shared_ptr<pmr::vector<int>> sharedr;
+
+		archive in(&ss);
+		in.set_memory_resource(&pool);
+		in >> &dictr >> &sharedr;
+
+		ok = dictr == dict && *sharedr == *shared &&
+			sharedr->get_allocator().resource() == &pool &&
+			dictr.begin()->second.get_allocator().resource() == &pool;
+	}
+	catch (bad_alloc const &)
+	{
+		ok = false;
+	}
+
+	pmr::set_default_resource(def);
+	assert_eq(ok, true);
+
+	return true;
+}
+
+
+
+
+bool chunked_containers()
+{
+	const int modes[] = { chunked_mode, chunked_mode | varint_mode };
+
+	for (int mode : modes)
+	{
+		vector<int> v(3 * CHUNK_ELEMENTS + 17);
+		for (auto &el : v)
+			el = random_value<int>();
+		list<string> l = { "a", "", "bc" };
+		map<int, vector<int>> m = { { 1, { 1, 2 } }, { 2, {} } };
+		vector<int> empty;
+
+		stringstream ss;
+		{
+			archive out(&ss, mode);
+			int n = serialize(out, &v);
+			assert_eq(n, serialize(out, &v, false));
+			out << &l << &m << &empty;
+		}
+
+		vector<int> vr, emptyr = { 1 };
+		list<string> lr;
+		map<int, vector<int>> mr;
+		archive(&ss, mode) >> &vr >> &lr >> &mr >> &emptyr;
+
+		assert_eq(v, vr);
+		assert_eq(l, lr);
+		assert_eq(m == mr, true);
+		assert_eq(emptyr.empty(), true);
+
+		// запись по одному элементу и массивами, чтение пачками
+		stringstream cs;
+		{
+			archive out(&cs, mode);
+			container_writer<int, stringstream> writer(out, 100);
+			for (int i = 0; i < 250; ++i)
+				writer.write(v[i]);
+			writer.write(v.data() + 250, v.size() - 250);
+			assert_eq(writer.finish(), true);
+		}
+
+		archive in(&cs, mode);
+		container_reader<int, stringstream> reader(in);
+		vector<int> batch, all;
+		while (reader.next(batch, 1000))
+		{
+			assert_eq(batch.size() <= 1000, true);
+			all.insert(all.end(), batch.begin(), batch.end());
+		}
+		assert_eq(reader.finished(), true);
+		assert_eq(reader.fail(), false);
+		assert_eq(all, v);
+
+		// поток от container_writer читается как обычный контейнер
+		cs.clear();
+		cs.seekg(0);
+		set<int> sr;
+		archive(&cs, mode) >> &sr;
+		assert_eq(sr, set<int>(v.begin(), v.end()));
+	}
+
+	// части больше CHUNK_ELEMENTS не пишутся и не читаются
+	{
+		vector<int> v(2 * CHUNK_ELEMENTS + 1, 7), vr;
+		stringstream ss;
+		{
+			archive out(&ss, chunked_mode);
+			container_writer<int, stringstream> writer(out, 4 * CHUNK_ELEMENTS);
+			writer.write(v.data(), v.size());
+		}
+		archive(&ss, chunked_mode) >> &vr;
+		assert_eq(v, vr);
+
+		buffer_ostream buf;
+		int32_t const corrupt[] = { CHUNK_ELEMENTS + 1, 0 };
+		archive(&buf, none_mode) << &corrupt[0] << &corrupt[1];
+		memory_istream ms(buf.data(), buf.size());
+		archive in(&ms, chunked_mode);
+		assert_eq(deserialize(in, &vr), 0);
+	}
+
+	// ошибка записи видна в finish, а деструктор при раскрутке
+	// стека контейнер не завершает
+	{
+		stringstream ss;
+		archive out(&ss, chunked_mode);
+		container_writer<int, stringstream> writer(out, 4);
+		writer.write(1);
+		ss.setstate(ios::badbit);
+		assert_eq(writer.finish(), false);
+	}
+	{
+		stringstream ss;
+		try
+		{
+			archive out(&ss, chunked_mode);
+			container_writer<int, stringstream> writer(out, 4);
+			for (int i = 0; i < 6; ++i)
+				writer.write(i);
+			throw 0;
+		}
+		catch (int) {}
+		assert_eq(ss.str().size(), sizeof(int32_t) + 4 * sizeof(int));
+	}
+
+	// delta_mode и hash_geometry_mode с chunked_mode не сочетаются
+	for (int mode : { delta_mode, hash_geometry_mode })
+	{
+		bool thrown = false;
+		try
+		{
+			buffer_ostream buf;
+			archive(&buf, chunked_mode | mode);
+		}
+		catch (char const *)
+		{
+			thrown = true;
+		}
+		assert_eq(thrown, true);
+	}
+
+	return true;
+}
+
+
+
+
+
+
+
 // END
@@ -0,0 +1,481 @@
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <nvx/iostream.hpp>
+#include <nvx/type.hpp>
+
+#include <assert.hpp>
+#include <random_value.hpp>
+
+#include <serialization.hpp>
+#include <serialization_async.hpp>
+#include <serialization_block.hpp>
+
+
+using namespace nvx;
+using namespace std;
+
+
+
+
+
+bool buffer_streams()
+{
+	for (int _ = 0; _ < 100; ++_)
+	{
+		int              intval  = random_value<int>(),              intvalr;
+		double           dblval  = random_value<double>(),           dblvalr;
+		string           str     = random_value<string>(),           strr;
+		vector<int>      vec     = random_value<vector<int>>(),      vecr;
+		map<int, string> strmap  = random_value<map<int, string>>(), strmapr;
+
+		// buffer_ostream
+		buffer_ostream buf;
+		archive(&buf) << &intval << &dblval << &str << &vec << &strmap;
+
+		stringstream ss(buf.str());
+		archive(&ss) >> &intvalr >> &dblvalr >> &strr >> &vecr >> &strmapr;
+
+		// staging_ostream with a buffer smaller than the data
+		stringstream staged;
+		{
+			staging_ostream<stringstream> stage(&staged, 16);
+			archive(&stage) << &intval << &dblval << &str << &vec << &strmap;
+		}
+
+		try
+		{
+			assert_eq(intval, intvalr, "intval != intvalr");
+			assert_eq(dblval, dblvalr, "dblval != dblvalr");
+			assert_eq(str,    strr,    "str != strr");
+			assert_eq(vec,    vecr,    "vec != vecr");
+			assert_eq(strmap, strmapr, "strmap != strmapr");
+			assert_eq(buf.str(), staged.str(), "buffer != staged");
+		}
+		catch (std::string const &err)
+		{
+			std::cerr << err << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+
+
+
+bool memory_streams()
+{
+	for (int _ = 0; _ < 100; ++_)
+	{
+		vector<string>   vec    = random_value<vector<string>>(),   vecr;
+		map<int, double> dblmap = random_value<map<int, double>>(), dblmapr, trunc;
+
+		buffer_ostream buf;
+		archive(&buf) << &vec << &dblmap;
+
+		memory_istream ms(buf.data(), buf.size());
+		archive(&ms) >> &vecr >> &dblmapr;
+
+		string src = serialize(&dblmap);
+		map<int, double> fromstr, fromptr;
+		int read    = deserialize(src, &fromstr);
+		int readptr = deserialize(src.data(), src.size(), &fromptr);
+		int readtr  = deserialize(src.data(), src.size() - 1, &trunc);
+
+		// из обрезанных данных читаются только целые элементы,
+		// а поток сообщает об ошибке
+		map<int, double> expected(dblmap);
+		if (!expected.empty())
+			expected.erase(prev(expected.end()));
+
+		memory_istream mstr(src.data(), src.size() - 1);
+		map<int, double> trunc2;
+		archive arctr(&mstr);
+		arctr >> &trunc2;
+
+		try
+		{
+			assert_eq(vec,    vecr,    "vec != vecr");
+			assert_eq(dblmap, dblmapr, "dblmap != dblmapr");
+			assert_eq(ms.remaining(), (size_t)0, "memory_istream not exhausted");
+			assert_eq(dblmap, fromstr, "dblmap != fromstr");
+			assert_eq(dblmap, fromptr, "dblmap != fromptr");
+			assert_eq(read,    (int)src.size(), "read != src.size()");
+			assert_eq(readptr, (int)src.size(), "readptr != src.size()");
+			assert_eq(readtr, 0, "truncated read succeeded");
+			assert_eq(trunc,  expected, "trunc != complete elements");
+			assert_eq(trunc2, expected, "trunc2 != complete elements");
+			assert_eq((bool)mstr,  false, "truncated stream did not fail");
+			assert_eq((bool)arctr, false, "truncated archive did not fail");
+		}
+		catch (std::string const &err)
+		{
+			std::cerr << err << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+
+
+struct Message
+{
+	string_view name;
+	span<double> values;
+
+	NVX_SERIALIZABLE(&name, &values);
+};
+
+bool memory_views()
+{
+	for (int _ = 0; _ < 50; ++_)
+	{
+		string name = random_value<string>();
+		vector<double> values(rnd(0, 100));
+		for (auto &val : values)
+			val = random_value<double>();
+		char tag = 1;
+
+		// буфер выровнен под double
+		buffer_ostream buf;
+		buf.reserve(4096);
+		archive out(&buf, aligned_mode);
+		out << &tag << &name;
+
+		// размер без записи учитывает наибольшее выравнивание
+		size_t before   = buf.size();
+		size_t estimate = serialize(out, &values, false);
+		out << &values;
+		size_t written  = buf.size() - before;
+		assert_eq(written <= estimate && estimate < written + alignof(double), true);
+
+		Message msg { name, values };
+		out << &tag << &msg;
+
+		vector<double> copy(buf.size() / sizeof(double) + 1);
+		memcpy(copy.data(), buf.data(), buf.size());
+		memory_istream ms((char const *)copy.data(), buf.size());
+		archive in(&ms, aligned_mode);
+
+		char tagr;
+		string_view namer;
+		span<double> valuesr;
+		Message msgr;
+		in >> &tagr >> &namer >> &valuesr >> &tagr >> &msgr;
+		assert_eq(ms.remaining(), (size_t)0);
+
+		assert_eq(string(namer), name);
+		assert_eq(vector<double>(valuesr.begin(), valuesr.end()), values);
+		assert_eq(string(msgr.name), name);
+		assert_eq(vector<double>(msgr.values.begin(), msgr.values.end()), values);
+		if (!values.empty())
+			assert_eq((char const *)valuesr.data() >= (char const *)copy.data(), true);
+
+		// тот же формат читается в обычные контейнеры
+		memory_istream ms2((char const *)copy.data(), buf.size());
+		string namer2;
+		vector<double> valuesr2;
+		archive(&ms2, aligned_mode) >> &tagr >> &namer2 >> &valuesr2;
+		assert_eq(namer2, name);
+		assert_eq(valuesr2, values);
+
+		// без aligned_mode выравнивание не гарантируется
+		if (!values.empty())
+		{
+			buffer_ostream plain;
+			archive(&plain) << &tag << &values;
+			memcpy(copy.data(), plain.data(), plain.size());
+			memory_istream ms4((char const *)copy.data(), plain.size());
+			archive in4(&ms4);
+			in4 >> &tagr;
+
+			bool thrown = false;
+			try
+			{
+				in4 >> &valuesr;
+			}
+			catch (char const *)
+			{
+				thrown = true;
+			}
+			assert_eq(thrown, true);
+		}
+
+		// дописанные в строку объекты выравниваются по позиции
+		// в самой строке и читаются одним архивом подряд
+		string appended;
+		serialize_append(appended, &tag, aligned_mode);
+		serialize_append(appended, &values, aligned_mode);
+		vector<double> copy5(appended.size() / sizeof(double) + 1);
+		memcpy(copy5.data(), appended.data(), appended.size());
+		memory_istream ms5((char const *)copy5.data(), appended.size());
+		vector<double> valuesr5;
+		archive(&ms5, aligned_mode) >> &tagr >> &valuesr5;
+		assert_eq(ms5.remaining(), (size_t)0);
+		assert_eq(tagr, tag);
+		assert_eq(valuesr5, values);
+	}
+
+	return true;
+}
+
+
+
+
+bool async_streams()
+{
+	for (int _ = 0; _ < 50; ++_)
+	{
+		vector<int>      vec    = random_value<vector<int>>();
+		map<int, string> strmap = random_value<map<int, string>>();
+		vector<double>   big(rnd(0, 10000), random_value<double>());
+
+		buffer_ostream expected;
+		archive(&expected) << &vec << &strmap << &big;
+
+		// буферы меньше данных: запись идёт многими порциями
+		stringstream ss;
+		{
+			async_ostream<stringstream> out(&ss, rnd(1, 256));
+			archive arch(&out);
+			arch << &vec << &strmap;
+			out.flush();
+			assert_eq(ss.str().size(), out.tellp());
+			arch << &big;
+			assert_eq((bool)out, true);
+		}
+
+		assert_eq(ss.str(), expected.str());
+	}
+
+	// нулевая ёмкость заменяется одним байтом
+	stringstream ss;
+	{
+		string str = "zero capacity";
+		async_ostream<stringstream> out(&ss, 0);
+		archive(&out) << &str;
+	}
+	assert_eq(ss.str().size(), sizeof(int32_t) + 13);
+
+	// после close запись ничего не делает и не зависает
+	{
+		stringstream ss2;
+		async_ostream<stringstream> out(&ss2, 4);
+		string str = "closed";
+		archive arch(&out);
+		arch << &str;
+		out.close();
+		assert_eq((bool)out, false);
+
+		arch << &str << &str;
+		out.write("tail", 4);
+		out.flush();
+		out.close();
+		assert_eq(ss2.str().size(), sizeof(int32_t) + 6);
+	}
+
+	return true;
+}
+
+
+
+
+bool block_streams()
+{
+	// кодек на данных разной сжимаемости
+	for (int _ = 0; _ < 200; ++_)
+	{
+		string raw(rnd(0, 5000), '\0');
+		int alphabet = rnd(1, 256);
+		for (auto &c : raw)
+			c = (char)rnd(0, alphabet - 1);
+		if (rnd(0, 1))
+			raw += raw.substr(0, rnd(0, (int)raw.size()));
+
+		string packed(lz_codec::bound(raw.size()), '\0');
+		packed.resize(lz_codec::compress(raw.data(), raw.size(), &packed[0]));
+
+		string unpacked(raw.size(), '\0');
+		assert_eq(lz_codec::decompress(packed.data(), packed.size(), &unpacked[0], raw.size()), true);
+		assert_eq(unpacked, raw);
+
+		// повреждённые данные не должны читаться за границы
+		if (!packed.empty())
+		{
+			packed[rnd(0, (int)packed.size() - 1)] ^= (char)rnd(1, 255);
+			lz_codec::decompress(packed.data(), packed.size(), &unpacked[0], raw.size());
+		}
+	}
+
+	for (int _ = 0; _ < 20; ++_)
+	{
+		vector<int>      ints(rnd(0, 50000), rnd(0, 10));
+		map<int, string> strmap = random_value<map<int, string>>();
+		vector<double>   noise(rnd(0, 1000));
+		for (auto &val : noise)
+			val = random_value<double>();
+
+		stringstream ss;
+		vector<size_t> marks;
+		{
+			block_ostream<stringstream> out(&ss, rnd(16, 4096));
+			archive arch(&out);
+			arch << &ints;
+			marks.push_back(out.tellp());
+			arch << &strmap;
+			marks.push_back(out.tellp());
+			arch << &noise;
+		}
+
+		// однородные данные сжимаются (остальные объекты
+		// случайны и могут не сжаться вовсе)
+		if (ints.size() > 10000)
+		{
+			stringstream packed;
+			{
+				block_ostream<stringstream> out(&packed, 4096);
+				archive(&out) << &ints;
+			}
+			assert_eq(packed.str().size() < ints.size() * sizeof(int) / 2, true);
+		}
+
+		// последовательное чтение
+		{
+			block_istream<stringstream> in(&ss);
+			vector<int>      intsr;
+			map<int, string> strmapr;
+			vector<double>   noiser;
+			archive(&in) >> &intsr >> &strmapr >> &noiser;
+
+			assert_eq((bool)in, true);
+			assert_eq(intsr, ints);
+			assert_eq(strmapr, strmap);
+			assert_eq(noiser, noise);
+		}
+
+		// чтение с произвольной позиции
+		{
+			ss.clear();
+			ss.seekg(0);
+			block_istream<stringstream> in(&ss);
+			archive arch(&in);
+
+			vector<double> noiser;
+			in.seekg(marks[1]);
+			arch >> &noiser;
+			assert_eq(noiser, noise);
+
+			map<int, string> strmapr;
+			in.seekg(marks[0]);
+			arch >> &strmapr;
+			assert_eq(strmapr, strmap);
+			assert_eq(in.tellg(), marks[1]);
+		}
+	}
+
+	return true;
+}
+
+
+
+
+template<class Codec>
+static bool check_block_checksums()
+{
+	vector<int>      ints(rnd(1, 20000), rnd(0, 10));
+	map<int, string> strmap = random_value<map<int, string>>();
+
+	stringstream ss;
+	{
+		block_ostream<stringstream, Codec> out(&ss, rnd(16, 4096), true);
+		archive(&out) << &ints << &strmap;
+	}
+	string const framed = ss.str();
+
+	{
+		stringstream in(framed);
+		block_istream<stringstream, Codec> bin(&in, 1 << 26, true);
+		vector<int>      intsr;
+		map<int, string> strmapr;
+		archive(&bin) >> &intsr >> &strmapr;
+
+		assert_eq((bool)bin, true);
+		assert_eq(intsr, ints);
+		assert_eq(strmapr, strmap);
+	}
+
+	// любое изменение одного байта обнаруживается
+	for (int i = 0; i < 50; ++i)
+	{
+		string broken = framed;
+		broken[rnd(0, (int)broken.size() - 1)] ^= (char)rnd(1, 255);
+
+		stringstream in(broken);
+		block_istream<stringstream, Codec> bin(&in, 1 << 26, true);
+		vector<int>      intsr;
+		map<int, string> strmapr;
+		archive(&bin) >> &intsr >> &strmapr;
+
+		assert_eq((bool)bin, false);
+	}
+
+	// блоки без контрольных сумм отвергаются, если они обязательны
+	{
+		stringstream plain;
+		{
+			block_ostream<stringstream, Codec> out(&plain);
+			archive(&out) << &ints;
+		}
+
+		block_istream<stringstream, Codec> bin(&plain, 1 << 26, true);
+		vector<int> intsr;
+		archive(&bin) >> &intsr;
+		assert_eq((bool)bin, false);
+	}
+
+	return true;
+}
+
+bool block_checksums()
+{
+	// известное значение CRC32C
+	assert_eq(crc32c("123456789", 9), 0xE3069283u);
+	assert_eq(crc32c("", 0), 0u);
+
+	for (int _ = 0; _ < 100; ++_)
+	{
+		string data = random_value<string>();
+		data.resize(rnd(0, 3000));
+
+		uint32_t crc = crc32c(data.data(), data.size());
+		assert_eq(~_crc32c_soft(~0u, (unsigned char const *)data.data(), data.size()), crc);
+
+		size_t k = rnd(0, (int)data.size());
+		assert_eq(crc32c(data.data() + k, data.size() - k, crc32c(data.data(), k)), crc);
+	}
+
+	for (int _ = 0; _ < 10; ++_)
+	{
+		if (!check_block_checksums<lz_codec>() || !check_block_checksums<null_codec>())
+			return false;
+	}
+
+	return true;
+}
+
+
+
+
+
+
+
+
+
+// END
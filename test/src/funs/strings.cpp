@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <sstream>
 
 #include <nvx/iostream.hpp>
@@ -17,6 +19,26 @@ using namespace std;
 
 
 
+/************************** STRUCTS *************************/
+// Считает, сколько раз объект был сериализован
+struct Counted
+{
+	vector<int> values;
+	mutable int passes = 0;
+
+	void after_serialization() const
+	{
+		++passes;
+	}
+
+	NVX_SERIALIZABLE(&values);
+};
+
+
+
+
+
+/************************** TESTS ***************************/
 bool strings()
 {
 	string s,  sr;
@@ -47,6 +69,79 @@ bool strings()
 	return true;
 }
 
+bool string_serialization()
+{
+	for (int i = 0; i < 50; ++i)
+	{
+		vector<string> v(rnd(0, 20));
+		for (auto &el : v)
+			el = random_value<string>();
+		map<int, string> m = { { 1, random_value<string>() }, { -5, "x" } };
+
+		// перезапись
+		string dst = serialize(&v);
+		int n = serialize(dst, &m);
+		assert_eq((size_t)n, dst.size());
+
+		map<int, string> mr;
+		assert_eq(deserialize(dst, &mr), n);
+		assert_eq(m, mr);
+
+		// добавление без перевыделения памяти
+		dst.reserve(1 << 16);
+		char const *data = dst.data();
+		int k = serialize_append(dst, &v);
+		assert_eq(dst.data(), data);
+		assert_eq((size_t)(n + k), dst.size());
+
+		memory_istream ms(dst);
+		vector<string> vr;
+		archive(&ms) >> &mr >> &vr;
+		assert_eq(m, mr);
+		assert_eq(v, vr);
+
+		// массивы
+		int size = v.size();
+		string *arr = v.data();
+		string arrs = serialize_array(&arr, &size);
+
+		string *arrr;
+		int sizer;
+		deserialize_array(arrs, &arrr, &sizer);
+		assert_eq(sizer, size);
+		assert_eq(equal(arr, arr + size, arrr), true);
+		delete[] arrr;
+
+		int stat[3] = { i, -i, 7 }, statr[3];
+		string stats;
+		serialize_static(stats, stat, 3, none_mode);
+		assert_eq(stats.size(), sizeof stat);
+		deserialize_static(stats, statr, 3, none_mode);
+		assert_eq(equal(stat, stat + 3, statr), true);
+
+		// разделяемые указатели в строке
+		auto p = make_shared<string>(random_value<string>());
+		pair<shared_ptr<string>, shared_ptr<string>> pp(p, p), ppr;
+		deserialize(serialize(&pp), &ppr);
+		assert_eq(*ppr.first, *p);
+		assert_eq(ppr.first, ppr.second);
+	}
+
+	// с отслеживанием указателей объект обходится один раз,
+	// без него размер считается без обхода
+	int const modes[] = { determine_shared_mode, determine_pointers_mode, none_mode };
+	for (int mode : modes)
+	{
+		Counted c { vector<int>(100, 3) };
+		string dst;
+		serialize(dst, &c, mode);
+		assert_eq(c.passes, mode == none_mode ? 2 : 1);
+		assert_eq(dst.size(), sizeof(int32_t) + 100 * sizeof(int));
+	}
+
+	return true;
+}
+
 
 
 
@@ -86,6 +86,26 @@ struct NoPlain
 };
 
 
+// элементы можно указывать через this и методы
+struct ThisElements
+{
+	int    a;
+	double b;
+
+	int *first()
+	{
+		return &a;
+	}
+
+	int const *first() const
+	{
+		return &a;
+	}
+
+	NVX_SERIALIZABLE(first(), &this->b, &this->a);
+};
+
+static_assert(serialized_size<ThisElements>() == 2 * sizeof(int) + sizeof(double));
 namespace nvx
 {
 	template<>
@@ -135,6 +155,30 @@ inline Ostream &operator<<( Ostream &os, NoPlain const &toprint )
 
 
 
+/*************************** FIXED **************************/
+struct Fixed
+{
+	int           a;
+	double        b;
+	pair<int, char> p;
+	Plain         plain;
+
+	NVX_SERIALIZABLE(&a, &b, &p, &plain);
+};
+
+static_assert(serialized_size<int>() == sizeof(int));
+static_assert(serialized_size<Plain>() == sizeof(Plain));
+static_assert(serialized_size<int[4]>() == 4 * sizeof(int));
+static_assert(serialized_size<Fixed>() ==
+	sizeof(int) + sizeof(double) + sizeof(int) + sizeof(char) + sizeof(Plain));
+static_assert(!is_fixed_size<NoPlain>::value);
+static_assert(!is_fixed_size<int *>::value);
+static_assert(!is_fixed_size<vector<int>>::value);
+
+
+
+
+
 /************************* FUNCTION *************************/
 bool user_structs()
 {
@@ -147,13 +191,17 @@ bool user_structs()
 		Plain   plain   = random_value<Plain>(),   plainr;
 		NoPlain noplain = random_value<NoPlain>(), noplainr;
 
-		archive(&ss) << &plain << &noplain;
-		archive(&ss) >> &plainr >> &noplainr;
+		ThisElements elems { random_value<int>(), random_value<double>() }, elemsr;
+
+		archive(&ss) << &plain << &noplain << &elems;
+		archive(&ss) >> &plainr >> &noplainr >> &elemsr;
 
 		try
 		{
 			assert_eq(plain,   plainr,   "plain != plainr");
 			assert_eq(noplain, noplainr, "noplain != noplainr");
+			assert_eq(elems.a, elemsr.a, "elems.a != elemsr.a");
+			assert_eq(elems.b, elemsr.b, "elems.b != elemsr.b");
 		}
 		catch(std::string const &err)
 		{
@@ -176,5 +224,46 @@ bool user_structs()
 
 
 
+bool serialized_sizes()
+{
+	for (int _ = 0; _ < 10; ++_)
+	{
+		NoPlain noplain = random_value<NoPlain>();
+		map<int, Plain> plains;
+		for (int i = 0, e = rnd(0, 20); i < e; ++i)
+			plains[i] = random_value<Plain>();
+
+		stringstream ss;
+		archive out(&ss);
+		int written = serialize(out, &noplain) + serialize(out, &plains);
+
+		archive<size_ostream> arch(nullptr);
+		int counted = serialize(arch, &plains, false);
+
+		try
+		{
+			assert_eq(
+				serialized_size(&noplain) + serialized_size(&plains),
+				(int)ss.str().size(),
+				"serialized_size != written"
+			);
+			assert_eq(written,  (int)ss.str().size(), "written != stream size");
+			assert_eq(counted,  serialized_size(&plains), "counted != serialized_size");
+		}
+		catch(std::string const &err)
+		{
+			std::cerr << err << std::endl;
+			return false;
+		}
+
+		delete[] noplain.dyn;
+		delete[] noplain.dynvec;
+	}
+
+	return true;
+}
+
+
+
 
 // END
@@ -26,14 +26,38 @@ int main( int argc, char *argv[] )
 {
 	auto tests = {
 		make_pair(&primitive_types,             "primitive_types"),
+		make_pair(&varint_primitive_types,      "varint_primitive_types"),
 		make_pair(&pointers_to_primitive_types, "pointers_to_primitive_types"),
 		make_pair(&arrays_and_plain,            "arrays_and_plain"),
 		make_pair(&std_containers,              "std_containers"),
+		make_pair(&delta_containers,            "delta_containers"),
+		make_pair(&ordered_containers,          "ordered_containers"),
+		make_pair(&unordered_geometry,          "unordered_geometry"),
+		make_pair(&pmr_containers,              "pmr_containers"),
+		make_pair(&chunked_containers,          "chunked_containers"),
 		make_pair(&strings,                     "strings"),
+		make_pair(&string_serialization,        "string_serialization"),
 		make_pair(&user_structs,                "user_structs"),
+		make_pair(&serialized_sizes,            "serialized_sizes"),
 		make_pair(&pointers,                    "pointers"),
+		make_pair(&arena_pointers,              "arena_pointers"),
+		make_pair(&iterative_pointers,          "iterative_pointers"),
+		make_pair(&pointer_tables,              "pointer_tables"),
 		make_pair(&shared_pointers_simple,      "shared_pointers_simple"),
 		make_pair(&circle_shared_pointers,      "circle_shared_pointers"),
+		make_pair(&buffer_streams,              "buffer_streams"),
+		make_pair(&memory_streams,              "memory_streams"),
+		make_pair(&memory_views,                "memory_views"),
+		make_pair(&mmap_streams,                "mmap_streams"),
+		make_pair(&async_streams,               "async_streams"),
+		make_pair(&block_streams,               "block_streams"),
+		make_pair(&block_checksums,             "block_checksums"),
+		make_pair(&bulk_containers,             "bulk_containers"),
+		make_pair(&endian_modes,                "endian_modes"),
+		make_pair(&parallel_serialization,      "parallel_serialization"),
+		make_pair(&indexed_serialization,       "indexed_serialization"),
+		make_pair(&archive_statistics,          "archive_statistics"),
+		make_pair(&static_modes,                "static_modes"),
 	};
 
 	int success = 0;